@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "inode.h"
+#include "diskimg.h"
+
+#define NICFREE 100   // size of s_free
+#define NICINOD 100   // size of s_inode
+#define INODES_PER_SECTOR (DISKIMG_SECTOR_SIZE / sizeof(struct inode))
+
+/**
+ * Layout of a block in the free-block chain.
+ */
+struct freechain {
+  uint16_t nfree;
+  uint16_t free[NICFREE];
+};
+
+static int isdatablock(struct unixfilesystem *fs, int blockNum) {
+  return blockNum >= INODE_START_SECTOR + fs->superblock.s_isize &&
+         blockNum < fs->superblock.s_fsize;
+}
+
+int alloc_block(struct unixfilesystem *fs) {
+  struct filsys *sb = &fs->superblock;
+  if (sb->s_nfree == 0 || sb->s_nfree > NICFREE) return -1;
+
+  int blockNum = sb->s_free[--sb->s_nfree];
+  sb->s_fmod = 1;
+  if (blockNum == 0) {
+    // End of the chain: the filesystem is full.
+    sb->s_nfree++;
+    return -1;
+  }
+  if (!isdatablock(fs, blockNum)) {
+    fprintf(stderr, "alloc_block: bad block %d on free list\n", blockNum);
+    return -1;
+  }
+
+  char buf[DISKIMG_SECTOR_SIZE];
+  if (sb->s_nfree == 0) {
+    // blockNum holds the next link of the chain; pull it in before reusing it.
+    if (unixfilesystem_readsector(fs, blockNum, buf) != DISKIMG_SECTOR_SIZE) return -1;
+    struct freechain *fc = (struct freechain *) buf;
+    if (fc->nfree > NICFREE) {
+      fprintf(stderr, "alloc_block: bad free count %d in block %d\n", fc->nfree, blockNum);
+      return -1;
+    }
+    sb->s_nfree = fc->nfree;
+    memcpy(sb->s_free, fc->free, sizeof(sb->s_free));
+  }
+
+  memset(buf, 0, sizeof(buf));
+  if (unixfilesystem_writesector(fs, blockNum, buf) != DISKIMG_SECTOR_SIZE) return -1;
+  return blockNum;
+}
+
+int alloc_freeblock(struct unixfilesystem *fs, int blockNum) {
+  struct filsys *sb = &fs->superblock;
+  if (!isdatablock(fs, blockNum)) return -1;
+
+  if (sb->s_nfree == 0) {
+    // An empty list still needs its end-of-chain marker.
+    sb->s_free[0] = 0;
+    sb->s_nfree = 1;
+  }
+  if (sb->s_nfree >= NICFREE) {
+    // Spill the in-core list into the block being freed and start a new one.
+    char buf[DISKIMG_SECTOR_SIZE];
+    memset(buf, 0, sizeof(buf));
+    struct freechain *fc = (struct freechain *) buf;
+    fc->nfree = sb->s_nfree;
+    memcpy(fc->free, sb->s_free, sizeof(sb->s_free));
+    if (unixfilesystem_writesector(fs, blockNum, buf) != DISKIMG_SECTOR_SIZE) return -1;
+    sb->s_nfree = 0;
+  }
+
+  sb->s_free[sb->s_nfree++] = blockNum;
+  sb->s_fmod = 1;
+  return 0;
+}
+
+/**
+ * Refills s_inode with up to NICINOD unallocated inumbers by scanning the
+ * inode area one sector at a time.
+ */
+static int refillinodes(struct unixfilesystem *fs) {
+  struct filsys *sb = &fs->superblock;
+  for (int s = 0; s < sb->s_isize && sb->s_ninode < NICINOD; s++) {
+    struct inode inodes[INODES_PER_SECTOR];
+    if (unixfilesystem_readsector(fs, INODE_START_SECTOR + s, inodes) != DISKIMG_SECTOR_SIZE) return -1;
+    for (size_t i = 0; i < INODES_PER_SECTOR && sb->s_ninode < NICINOD; i++) {
+      if ((inodes[i].i_mode & IALLOC) == 0) {
+        sb->s_inode[sb->s_ninode++] = s * INODES_PER_SECTOR + i + 1;
+      }
+    }
+  }
+  sb->s_fmod = 1;
+  return 0;
+}
+
+int alloc_inode(struct unixfilesystem *fs) {
+  struct filsys *sb = &fs->superblock;
+  if (sb->s_ninode > NICINOD) sb->s_ninode = 0;
+  while (1) {
+    if (sb->s_ninode == 0) {
+      if (refillinodes(fs) < 0) return -1;
+      if (sb->s_ninode == 0) return -1;
+    }
+
+    int inumber = sb->s_inode[--sb->s_ninode];
+    sb->s_fmod = 1;
+    struct inode in;
+    if (inode_iget(fs, inumber, &in) < 0) return -1;
+    if ((in.i_mode & IALLOC) == 0) return inumber;
+    // Stale entry; the inode was allocated behind the cache's back.
+  }
+}
+
+int alloc_freeinode(struct unixfilesystem *fs, int inumber) {
+  struct filsys *sb = &fs->superblock;
+  if (sb->s_ninode < NICINOD) {
+    sb->s_inode[sb->s_ninode++] = inumber;
+    sb->s_fmod = 1;
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef _ALLOC_H_
+#define _ALLOC_H_
+
+#include "unixfilesystem.h"
+
+/**
+ * Free block and free inode management, following alloc.c from Unix Version 6.
+ *
+ * Free blocks are kept in s_free[0..s_nfree-1] of the superblock.  When that
+ * array runs dry, s_free[0] names a block whose first word is the next
+ * s_nfree and whose next 100 words are the next s_free, and so on down a chain
+ * that ends at block number 0.  Free inodes are cached in s_inode; when that
+ * cache is empty it is refilled by scanning the inode area.  All of these
+ * routines only modify the in-memory superblock (and set s_fmod), so call
+ * unixfilesystem_sync() to make the changes permanent.
+ */
+
+/**
+ * Takes a block off the free list and zeroes it.  Returns the block number,
+ * or -1 if the filesystem is full or an error occurs.
+ */
+int alloc_block(struct unixfilesystem *fs);
+
+/**
+ * Puts the specified block back on the free list.  Returns 0 on success,
+ * -1 on error.
+ */
+int alloc_freeblock(struct unixfilesystem *fs, int blockNum);
+
+/**
+ * Picks an unallocated inode.  The inode isn't marked as allocated until the
+ * caller sets IALLOC in its mode and writes it back with inode_iput().
+ * Returns the inumber, or -1 if there are no free inodes or an error occurs.
+ */
+int alloc_inode(struct unixfilesystem *fs);
+
+/**
+ * Remembers the specified (already cleared) inode as free.  Returns 0.
+ */
+int alloc_freeinode(struct unixfilesystem *fs, int inumber);
+
+#endif // _ALLOC_H_
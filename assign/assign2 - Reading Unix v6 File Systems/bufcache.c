@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bufcache.h"
+#include "diskimg.h"
+#include "fsstats.h"
+
+// Most sectors bufcache_sync() hands to the disk in one request.
+#define MAX_RUN_SECTORS 128
+
+#define NO_BUF (-1)
+
+struct buf {
+  int sector;       // sector held in data, or -1 if the buffer is unused
+  int dirty;
+  int hnext;        // next buffer in the same hash chain
+  int prev, next;   // neighbours in the LRU list, most recently used first
+  uint8_t data[DISKIMG_SECTOR_SIZE];
+};
+
+struct bufcache {
+  int dfd;
+  int numBuffers;
+  struct buf *bufs;
+  int numBuckets;   // always a power of two
+  int *buckets;
+  int lruHead, lruTail;
+  uint8_t run[MAX_RUN_SECTORS * DISKIMG_SECTOR_SIZE];
+};
+
+static int hashsector(struct bufcache *bc, int sectorNum) {
+  return (sectorNum * 2654435761u) & (bc->numBuckets - 1);
+}
+
+static void lru_unlink(struct bufcache *bc, int b) {
+  struct buf *bp = &bc->bufs[b];
+  if (bp->prev != NO_BUF) bc->bufs[bp->prev].next = bp->next; else bc->lruHead = bp->next;
+  if (bp->next != NO_BUF) bc->bufs[bp->next].prev = bp->prev; else bc->lruTail = bp->prev;
+}
+
+static void lru_pushfront(struct bufcache *bc, int b) {
+  struct buf *bp = &bc->bufs[b];
+  bp->prev = NO_BUF;
+  bp->next = bc->lruHead;
+  if (bc->lruHead != NO_BUF) bc->bufs[bc->lruHead].prev = b; else bc->lruTail = b;
+  bc->lruHead = b;
+}
+
+static int hash_find(struct bufcache *bc, int sectorNum) {
+  for (int b = bc->buckets[hashsector(bc, sectorNum)]; b != NO_BUF; b = bc->bufs[b].hnext) {
+    if (bc->bufs[b].sector == sectorNum) return b;
+  }
+  return NO_BUF;
+}
+
+static void hash_remove(struct bufcache *bc, int b) {
+  int *link = &bc->buckets[hashsector(bc, bc->bufs[b].sector)];
+  while (*link != b) link = &bc->bufs[*link].hnext;
+  *link = bc->bufs[b].hnext;
+}
+
+static void hash_insert(struct bufcache *bc, int b) {
+  int *head = &bc->buckets[hashsector(bc, bc->bufs[b].sector)];
+  bc->bufs[b].hnext = *head;
+  *head = b;
+}
+
+struct bufcache *bufcache_create(int dfd, int numBuffers) {
+  if (numBuffers < 1) return NULL;
+  struct bufcache *bc = malloc(sizeof(struct bufcache));
+  if (bc == NULL) return NULL;
+
+  bc->dfd = dfd;
+  bc->numBuffers = numBuffers;
+  bc->numBuckets = 1;
+  while (bc->numBuckets < numBuffers) bc->numBuckets *= 2;
+  bc->bufs = malloc(numBuffers * sizeof(struct buf));
+  bc->buckets = malloc(bc->numBuckets * sizeof(int));
+  if (bc->bufs == NULL || bc->buckets == NULL) {
+    bufcache_free(bc);
+    return NULL;
+  }
+
+  for (int i = 0; i < bc->numBuckets; i++) bc->buckets[i] = NO_BUF;
+  bc->lruHead = bc->lruTail = NO_BUF;
+  for (int b = 0; b < numBuffers; b++) {
+    bc->bufs[b].sector = -1;
+    bc->bufs[b].dirty = 0;
+    lru_pushfront(bc, b);
+  }
+  return bc;
+}
+
+/**
+ * Hands back a buffer for sectorNum, recycling the least recently used one
+ * (and writing it back first if it is dirty).  The buffer's contents are
+ * undefined; callers either fill it from the disk or overwrite all of it.
+ */
+static int getbuf(struct bufcache *bc, int sectorNum) {
+  int b = bc->lruTail;
+  struct buf *bp = &bc->bufs[b];
+  if (bp->sector >= 0) {
+    if (bp->dirty && diskimg_writesector(bc->dfd, bp->sector, bp->data) != DISKIMG_SECTOR_SIZE) {
+      return NO_BUF;
+    }
+    hash_remove(bc, b);
+  }
+
+  bp->sector = sectorNum;
+  bp->dirty = 0;
+  hash_insert(bc, b);
+  return b;
+}
+
+static void touch(struct bufcache *bc, int b) {
+  if (bc->lruHead == b) return;
+  lru_unlink(bc, b);
+  lru_pushfront(bc, b);
+}
+
+int bufcache_read(struct bufcache *bc, int sectorNum, void *buf) {
+  int b = hash_find(bc, sectorNum);
+  if (b != NO_BUF) {
+    fsstats.cacheHits++;
+  } else {
+    fsstats.cacheMisses++;
+    b = getbuf(bc, sectorNum);
+    if (b == NO_BUF) return -1;
+    if (diskimg_readsector(bc->dfd, sectorNum, bc->bufs[b].data) != DISKIMG_SECTOR_SIZE) {
+      hash_remove(bc, b);
+      bc->bufs[b].sector = -1;
+      return -1;
+    }
+  }
+
+  touch(bc, b);
+  memcpy(buf, bc->bufs[b].data, DISKIMG_SECTOR_SIZE);
+  return DISKIMG_SECTOR_SIZE;
+}
+
+int bufcache_write(struct bufcache *bc, int sectorNum, void *buf) {
+  int b = hash_find(bc, sectorNum);
+  if (b == NO_BUF) {
+    b = getbuf(bc, sectorNum);
+    if (b == NO_BUF) return -1;
+  }
+
+  touch(bc, b);
+  memcpy(bc->bufs[b].data, buf, DISKIMG_SECTOR_SIZE);
+  bc->bufs[b].dirty = 1;
+  return DISKIMG_SECTOR_SIZE;
+}
+
+static struct bufcache *sortcache; // qsort has no context argument
+static int comparesectors(const void *a, const void *b) {
+  return sortcache->bufs[*(const int *) a].sector - sortcache->bufs[*(const int *) b].sector;
+}
+
+int bufcache_sync(struct bufcache *bc) {
+  int *dirty = malloc(bc->numBuffers * sizeof(int));
+  if (dirty == NULL) return -1;
+  int numDirty = 0;
+  for (int b = 0; b < bc->numBuffers; b++) {
+    if (bc->bufs[b].sector >= 0 && bc->bufs[b].dirty) dirty[numDirty++] = b;
+  }
+
+  sortcache = bc;
+  qsort(dirty, numDirty, sizeof(int), comparesectors);
+
+  int err = 0;
+  for (int i = 0; i < numDirty; ) {
+    // Gather the run of consecutive sectors starting at dirty[i].
+    int first = bc->bufs[dirty[i]].sector;
+    int len = 0;
+    while (i + len < numDirty && len < MAX_RUN_SECTORS &&
+           bc->bufs[dirty[i + len]].sector == first + len) {
+      memcpy(bc->run + len * DISKIMG_SECTOR_SIZE, bc->bufs[dirty[i + len]].data, DISKIMG_SECTOR_SIZE);
+      len++;
+    }
+
+    if (diskimg_writesectors(bc->dfd, first, len, bc->run) != len * DISKIMG_SECTOR_SIZE) {
+      err = -1;
+      break;
+    }
+    for (int j = 0; j < len; j++) bc->bufs[dirty[i + j]].dirty = 0;
+    i += len;
+  }
+
+  free(dirty);
+  return err;
+}
+
+void bufcache_free(struct bufcache *bc) {
+  if (bc == NULL) return;
+  free(bc->bufs);
+  free(bc->buckets);
+  free(bc);
+}
@@ -0,0 +1,44 @@
+#ifndef _BUFCACHE_H_
+#define _BUFCACHE_H_
+
+/**
+ * A write-back cache of disk sectors sitting between the filesystem layers
+ * and the diskimg module.  Writes only mark a cached sector dirty, so repeated
+ * writes to the same sector (an indirect block, an inode sector, the tail of a
+ * growing file) are coalesced into one disk write.  Dirty sectors reach the
+ * disk when they are evicted or when bufcache_sync() is called, which writes
+ * them in sorted order, merging runs of adjacent sectors into single requests.
+ */
+struct bufcache;
+
+/**
+ * Creates a cache of numBuffers sectors for the disk image open on dfd.
+ * Returns NULL if unsuccessful.
+ */
+struct bufcache *bufcache_create(int dfd, int numBuffers);
+
+/**
+ * Reads the specified sector into buf, from the cache if it is there and from
+ * the disk otherwise.  Returns the number of bytes read, or -1 on error.
+ */
+int bufcache_read(struct bufcache *bc, int sectorNum, void *buf);
+
+/**
+ * Copies buf into the cached copy of the specified sector and marks it dirty.
+ * Returns the number of bytes written, or -1 on error.
+ */
+int bufcache_write(struct bufcache *bc, int sectorNum, void *buf);
+
+/**
+ * Writes every dirty sector back to the disk in ascending sector order.
+ * Returns 0 on success, -1 on error.
+ */
+int bufcache_sync(struct bufcache *bc);
+
+/**
+ * Releases the cache.  Dirty sectors are discarded, so call bufcache_sync()
+ * first if they matter.
+ */
+void bufcache_free(struct bufcache *bc);
+
+#endif // _BUFCACHE_H_
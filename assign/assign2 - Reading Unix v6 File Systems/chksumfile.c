@@ -11,6 +11,7 @@
 #include "directory.h"
 #include "pathname.h"
 #include "chksumfile.h"
+#include "fsstats.h"
 #include <openssl/sha.h>
 
 int chksumfile_byinumber(struct unixfilesystem *fs, int inumber, void *chksum) {
@@ -31,6 +32,7 @@ int chksumfile_byinumber(struct unixfilesystem *fs, int inumber, void *chksum) {
     return -1;
   }
 
+  fsstats.filesHashed++;
   int size = inode_getsize(&in);
   for (int offset = 0; offset < size; offset += DISKIMG_SECTOR_SIZE) {
     char buf[DISKIMG_SECTOR_SIZE];
@@ -42,6 +44,7 @@ int chksumfile_byinumber(struct unixfilesystem *fs, int inumber, void *chksum) {
 
     if (!SHA1_Update(&shactx, buf, bytesMoved))
       return -1;
+    fsstats.bytesHashed += bytesMoved;
   }
 
   if (!SHA1_Final(chksum, &shactx))
@@ -2,16 +2,30 @@
 #include "inode.h"
 #include "diskimg.h"
 #include "file.h"
+#include "fsstats.h"
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
+#define NAME_MAX_LEN ((int) sizeof(((struct direntv6 *) 0)->d_name))
+
+/**
+ * Returns 1 if the in-use entry is named name.  d_name is only NUL
+ * terminated when the name is shorter than NAME_MAX_LEN.
+ */
+static int entry_matches(const struct direntv6 *entry, const char *name) {
+	return entry->d_inumber != 0 && strncmp(entry->d_name, name, NAME_MAX_LEN) == 0;
+}
+
 /**
  * Looks up the specified name (name) in the specified directory (dirinumber).  
  * If found, return the directory entry in space addressed by dirEnt.  Returns 0 
  * on success and something negative on failure. 
  */
 int directory_findname(struct unixfilesystem *fs, const char *name, int dirinumber, struct direntv6 *dirEnt) {
+	fsstats.dirLookups++;
+	if((int) strlen(name) > NAME_MAX_LEN) return -1;
+
 	// get inode information
 	struct inode my_node;
 	int err = inode_iget(fs, dirinumber, &my_node);
@@ -30,12 +44,12 @@ int directory_findname(struct unixfilesystem *fs, const char *name, int dirinumb
 	int total_block_num = (dir_size - 1) / DISKIMG_SECTOR_SIZE + 1;
 	for(int i = 0; i < total_block_num; i++) {		// check all blocks
 		struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+		fsstats.dirBlocksScanned++;
 		int valid_bytes = file_getblock(fs, dirinumber, i, entries);
 		if(valid_bytes < 0) return -1;
 		int total_entry_num = valid_bytes / sizeof(struct direntv6);
 		for(int j = 0; j < total_entry_num; j++) {	// check all valid entries in a block
-			int cmp = strcmp(entries[j].d_name, name);
-			if(cmp == 0) {
+			if(entry_matches(&entries[j], name)) {
 				*dirEnt = entries[j];
 				return 0;	
 			}
@@ -45,3 +59,113 @@ int directory_findname(struct unixfilesystem *fs, const char *name, int dirinumb
 	// no such entry, return -1
 	return -1;
 }
+
+
+/**
+ * Adds an entry mapping name to inumber to the specified directory.
+ * Returns 0 on success and something negative on failure.
+ */
+int directory_addentry(struct unixfilesystem *fs, int dirinumber, const char *name, int inumber) {
+	int name_len = strlen(name);
+	if(name_len == 0 || name_len > NAME_MAX_LEN) return -1;
+
+	struct inode my_node;
+	if(inode_iget(fs, dirinumber, &my_node) < 0) return -1;
+	if((my_node.i_mode & IFMT) != IFDIR) return -1;
+
+	struct direntv6 new_entry;
+	memset(&new_entry, 0, sizeof(new_entry));
+	new_entry.d_inumber = inumber;
+	memcpy(new_entry.d_name, name, name_len);
+
+	// look for a duplicate and remember the first free slot
+	int dir_size = inode_getsize(&my_node);
+	int total_block_num = (dir_size + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+	int free_sector = -1, free_slot = -1;
+	for(int i = 0; i < total_block_num; i++) {
+		struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+		fsstats.dirBlocksScanned++;
+		int valid_bytes = file_getblock(fs, dirinumber, i, entries);
+		if(valid_bytes < 0) return -1;
+		int total_entry_num = valid_bytes / sizeof(struct direntv6);
+		for(int j = 0; j < total_entry_num; j++) {
+			if(entry_matches(&entries[j], name)) return -1;
+			if(entries[j].d_inumber == 0 && free_sector < 0) {
+				free_sector = inode_indexlookup(fs, &my_node, i);
+				if(free_sector < 0) return -1;
+				free_slot = j;
+			}
+		}
+	}
+
+	// no free slot, so the directory grows by one entry
+	if(free_sector < 0) {
+		return file_append(fs, dirinumber, &new_entry, sizeof(new_entry)) < 0 ? -1 : 0;
+	}
+
+	struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+	if(unixfilesystem_readsector(fs, free_sector, entries) < 0) return -1;
+	entries[free_slot] = new_entry;
+	if(unixfilesystem_writesector(fs, free_sector, entries) < 0) return -1;
+	return 0;
+}
+
+
+/**
+ * Clears the entry for name in the specified directory.  Returns the
+ * inumber the entry referred to, or something negative on failure.
+ */
+int directory_removeentry(struct unixfilesystem *fs, int dirinumber, const char *name) {
+	if((int) strlen(name) > NAME_MAX_LEN) return -1;
+
+	struct inode my_node;
+	if(inode_iget(fs, dirinumber, &my_node) < 0) return -1;
+	if((my_node.i_mode & IFMT) != IFDIR) return -1;
+
+	int dir_size = inode_getsize(&my_node);
+	int total_block_num = (dir_size + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+	for(int i = 0; i < total_block_num; i++) {
+		struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+		fsstats.dirBlocksScanned++;
+		int valid_bytes = file_getblock(fs, dirinumber, i, entries);
+		if(valid_bytes < 0) return -1;
+		int total_entry_num = valid_bytes / sizeof(struct direntv6);
+		for(int j = 0; j < total_entry_num; j++) {
+			if(!entry_matches(&entries[j], name)) continue;
+			int inumber = entries[j].d_inumber;
+			memset(&entries[j], 0, sizeof(entries[j]));
+			int sector = inode_indexlookup(fs, &my_node, i);
+			if(sector < 0) return -1;
+			if(unixfilesystem_writesector(fs, sector, entries) < 0) return -1;
+			return inumber;
+		}
+	}
+	return -1;
+}
+
+
+/**
+ * Returns 1 if the specified directory holds nothing but "." and "..",
+ * 0 if it holds anything else, and something negative on failure.
+ */
+int directory_isempty(struct unixfilesystem *fs, int dirinumber) {
+	struct inode my_node;
+	if(inode_iget(fs, dirinumber, &my_node) < 0) return -1;
+	if((my_node.i_mode & IFMT) != IFDIR) return -1;
+
+	int dir_size = inode_getsize(&my_node);
+	int total_block_num = (dir_size + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+	for(int i = 0; i < total_block_num; i++) {
+		struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+		fsstats.dirBlocksScanned++;
+		int valid_bytes = file_getblock(fs, dirinumber, i, entries);
+		if(valid_bytes < 0) return -1;
+		int total_entry_num = valid_bytes / sizeof(struct direntv6);
+		for(int j = 0; j < total_entry_num; j++) {
+			if(entries[j].d_inumber == 0) continue;
+			if(entry_matches(&entries[j], ".") || entry_matches(&entries[j], "..")) continue;
+			return 0;
+		}
+	}
+	return 1;
+}
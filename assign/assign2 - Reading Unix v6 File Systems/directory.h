@@ -12,4 +12,24 @@
 int directory_findname(struct unixfilesystem *fs, const char *name,
                        int dirinumber, struct direntv6 *dirEnt);
 
+/**
+ * Adds an entry mapping name to inumber to the specified directory, reusing
+ * a free slot if there is one and growing the directory otherwise.  Returns 0
+ * on success and something negative on failure (including when name is
+ * already present or is longer than a directory entry allows).
+ */
+int directory_addentry(struct unixfilesystem *fs, int dirinumber, const char *name, int inumber);
+
+/**
+ * Clears the entry for name in the specified directory.  Returns the inumber
+ * the entry referred to, or something negative on failure.
+ */
+int directory_removeentry(struct unixfilesystem *fs, int dirinumber, const char *name);
+
+/**
+ * Returns 1 if the specified directory holds nothing but "." and "..",
+ * 0 if it holds anything else, and something negative on failure.
+ */
+int directory_isempty(struct unixfilesystem *fs, int dirinumber);
+
 #endif // _DIECTORY_H_
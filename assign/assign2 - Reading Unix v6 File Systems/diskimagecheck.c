@@ -0,0 +1,442 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "diskimg.h"
+#include "unixfilesystem.h"
+#include "inode.h"
+#include "direntv6.h"
+
+/**
+ * A consistency checker for Unix v6 disk images in the spirit of fsck.
+ *
+ * Each image is checked in a single linear pass over its inode area.  Every
+ * allocated inode has its block map walked (reading only indirect blocks) to
+ * build a block ownership table, and every directory has its entries read to
+ * count references to each inode.  File data is never read and no pathname
+ * is ever resolved, so the cost grows with the size of the image's metadata
+ * rather than with the number of paths.  The free list is then walked and
+ * cross-checked against the ownership table.
+ *
+ * Images are checked in parallel, one child process per image, with at most
+ * one child per CPU (or -j of them) running at once.  The exit status is 0
+ * if every image is clean, 1 if problems were found and 2 on errors.
+ */
+
+#define INODES_PER_SECTOR (DISKIMG_SECTOR_SIZE / sizeof(struct inode))
+#define ADDRS_PER_BLOCK (DISKIMG_SECTOR_SIZE / sizeof(uint16_t))
+#define ENTRIES_PER_BLOCK (DISKIMG_SECTOR_SIZE / sizeof(struct direntv6))
+#define NUM_INDIRECT 7
+#define NICFREE 100
+
+// Values in the block ownership table other than inumbers.
+#define BLOCK_UNCLAIMED 0
+#define BLOCK_FREE (-1)
+#define BLOCK_SYSTEM (-2)
+
+#define EXIT_PROBLEMS 1
+#define EXIT_ERROR 2
+
+struct checker {
+  struct unixfilesystem *fs;
+  const char *name;          // image name used to prefix every line
+  FILE *out;
+  int quiet;
+  int numInodes;
+  int numBlocks;
+  int *owner;                // per block: inumber, BLOCK_FREE, BLOCK_SYSTEM or BLOCK_UNCLAIMED
+  uint16_t *modes;           // per inumber
+  uint8_t *nlinks;           // per inumber
+  int *refs;                 // per inumber: directory entries naming it
+  int *dataBlocks;           // scratch block map of the directory being scanned
+  int dataBlocksCap;
+  int problems;
+  int numFiles, numDirs;
+};
+
+static int quietFlag = 0;
+
+static int CheckImage(char *diskpath, int quiet);
+static void PrintUsageAndExit(char *progname);
+
+int main(int argc, char *argv[]) {
+  int maxJobs = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+  while ((opt = getopt(argc, argv, "qj:")) != -1) {
+    switch (opt) {
+    case 'q':
+      quietFlag = 1;
+      break;
+    case 'j':
+      maxJobs = atoi(optarg);
+      break;
+    default:
+      PrintUsageAndExit(argv[0]);
+    }
+  }
+
+  if (optind == argc || maxJobs < 1) {
+    PrintUsageAndExit(argv[0]);
+  }
+
+  fflush(stdout);
+  int running = 0, worst = EXIT_SUCCESS, numProblemImages = 0;
+  for (int i = optind; i < argc || running > 0; ) {
+    if (i < argc && running < maxJobs) {
+      pid_t pid = fork();
+      if (pid == 0) exit(CheckImage(argv[i], quietFlag));
+      if (pid < 0) {
+        fprintf(stderr, "Can't fork to check %s\n", argv[i]);
+        worst = EXIT_ERROR;
+      } else {
+        running++;
+      }
+      i++;
+      continue;
+    }
+
+    int status;
+    if (waitpid(-1, &status, 0) < 0) break;
+    running--;
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_ERROR;
+    if (code != EXIT_SUCCESS) numProblemImages++;
+    if (code > worst) worst = code;
+  }
+
+  printf("Checked %d images, %d with problems\n", argc - optind, numProblemImages);
+  exit(worst);
+  return 0;
+}
+
+static void Report(struct checker *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void Report(struct checker *c, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fprintf(c->out, "%s: ", c->name);
+  vfprintf(c->out, fmt, args);
+  fprintf(c->out, "\n");
+  va_end(args);
+  c->problems++;
+}
+
+/**
+ * Records that inumber uses block blockNum.  Returns 1 if the block is a
+ * legitimate data block that may be followed, 0 otherwise.  A block that is
+ * already used is reported but not followed, so a shared indirect block is
+ * reported once rather than once per block it maps.
+ */
+static int ClaimBlock(struct checker *c, int inumber, int blockNum) {
+  if (blockNum < INODE_START_SECTOR + c->fs->superblock.s_isize || blockNum >= c->numBlocks) {
+    Report(c, "inode %d uses out-of-range block %d", inumber, blockNum);
+    return 0;
+  }
+
+  int prev = c->owner[blockNum];
+  if (prev == BLOCK_UNCLAIMED) {
+    c->owner[blockNum] = inumber;
+    return 1;
+  }
+  Report(c, "block %d is used by both inode %d and inode %d", blockNum, prev, inumber);
+  return 0;
+}
+
+/**
+ * Claims every block reachable from the given inode.  For directories,
+ * dataBlocks receives the block number of each of the first numDataBlocks
+ * file blocks (0 where there is a hole).  Returns 0, or -1 on I/O errors.
+ */
+static int WalkBlocks(struct checker *c, int inumber, struct inode *inp, int *dataBlocks, int numDataBlocks) {
+  int numDirect = sizeof(inp->i_addr) / sizeof(inp->i_addr[0]);
+  if ((inp->i_mode & ILARG) == 0) {
+    for (int i = 0; i < numDirect; i++) {
+      if (inp->i_addr[i] == 0) continue;
+      if (ClaimBlock(c, inumber, inp->i_addr[i]) && i < numDataBlocks) dataBlocks[i] = inp->i_addr[i];
+    }
+    return 0;
+  }
+
+  for (int i = 0; i <= NUM_INDIRECT; i++) {
+    if (inp->i_addr[i] == 0 || !ClaimBlock(c, inumber, inp->i_addr[i])) continue;
+    uint16_t addrs[ADDRS_PER_BLOCK];
+    if (unixfilesystem_readsector(c->fs, inp->i_addr[i], addrs) != DISKIMG_SECTOR_SIZE) return -1;
+
+    for (size_t j = 0; j < ADDRS_PER_BLOCK; j++) {
+      if (addrs[j] == 0 || !ClaimBlock(c, inumber, addrs[j])) continue;
+      if (i < NUM_INDIRECT) {
+        int bno = i * ADDRS_PER_BLOCK + j;
+        if (bno < numDataBlocks) dataBlocks[bno] = addrs[j];
+        continue;
+      }
+
+      // doubly indirect: addrs[j] is itself an indirect block
+      uint16_t addrs2[ADDRS_PER_BLOCK];
+      if (unixfilesystem_readsector(c->fs, addrs[j], addrs2) != DISKIMG_SECTOR_SIZE) return -1;
+      for (size_t k = 0; k < ADDRS_PER_BLOCK; k++) {
+        if (addrs2[k] == 0 || !ClaimBlock(c, inumber, addrs2[k])) continue;
+        int bno = (NUM_INDIRECT + j) * ADDRS_PER_BLOCK + k;
+        if (bno < numDataBlocks) dataBlocks[bno] = addrs2[k];
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Reads every entry of the directory whose data blocks were gathered by
+ * WalkBlocks, counting references and flagging malformed entries.
+ */
+static int ScanDirectory(struct checker *c, int inumber, int size, int *dataBlocks, int numDataBlocks) {
+  if (size % sizeof(struct direntv6) != 0) {
+    Report(c, "directory %d has size %d, not a multiple of the entry size", inumber, size);
+  }
+
+  int sawDot = 0, sawDotDot = 0;
+  for (int b = 0; b < numDataBlocks; b++) {
+    if (dataBlocks[b] == 0) {
+      Report(c, "directory %d has no block %d", inumber, b);
+      continue;
+    }
+
+    struct direntv6 entries[ENTRIES_PER_BLOCK];
+    if (unixfilesystem_readsector(c->fs, dataBlocks[b], entries) != DISKIMG_SECTOR_SIZE) return -1;
+    int bytes = size - b * DISKIMG_SECTOR_SIZE;
+    int numEntries = (bytes >= DISKIMG_SECTOR_SIZE ? DISKIMG_SECTOR_SIZE : bytes) / sizeof(struct direntv6);
+    for (int e = 0; e < numEntries; e++) {
+      struct direntv6 *ent = &entries[e];
+      if (ent->d_inumber == 0) continue;
+
+      char name[sizeof(ent->d_name) + 1];
+      memcpy(name, ent->d_name, sizeof(ent->d_name));
+      name[sizeof(ent->d_name)] = '\0';
+      if (ent->d_inumber > c->numInodes) {
+        Report(c, "directory %d entry \"%s\" names out-of-range inode %d", inumber, name, ent->d_inumber);
+        continue;
+      }
+      if (name[0] == '\0' || strchr(name, '/') != NULL) {
+        Report(c, "directory %d has an entry with bad name \"%s\" for inode %d", inumber, name, ent->d_inumber);
+      }
+      if (strcmp(name, ".") == 0) {
+        sawDot = 1;
+        if (ent->d_inumber != inumber) {
+          Report(c, "directory %d has \".\" pointing at inode %d", inumber, ent->d_inumber);
+        }
+      }
+      if (strcmp(name, "..") == 0) sawDotDot = 1;
+      c->refs[ent->d_inumber]++;
+    }
+  }
+
+  if (!sawDot) Report(c, "directory %d has no \".\" entry", inumber);
+  if (!sawDotDot) Report(c, "directory %d has no \"..\" entry", inumber);
+  return 0;
+}
+
+/**
+ * The linear pass: every sector of the inode area is read once, in order.
+ */
+static int CheckInodes(struct checker *c) {
+  for (int s = 0; s < c->fs->superblock.s_isize; s++) {
+    struct inode inodes[INODES_PER_SECTOR];
+    if (unixfilesystem_readsector(c->fs, INODE_START_SECTOR + s, inodes) != DISKIMG_SECTOR_SIZE) return -1;
+
+    for (size_t i = 0; i < INODES_PER_SECTOR; i++) {
+      struct inode *inp = &inodes[i];
+      int inumber = s * INODES_PER_SECTOR + i + 1;
+      c->modes[inumber] = inp->i_mode;
+      c->nlinks[inumber] = inp->i_nlink;
+      if ((inp->i_mode & IALLOC) == 0) continue;
+
+      int isDir = ((inp->i_mode & IFMT) == IFDIR);
+      int size = inode_getsize(inp);
+      int numDataBlocks = isDir ? (size + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE : 0;
+      if (numDataBlocks > c->dataBlocksCap) {
+        int *grown = realloc(c->dataBlocks, numDataBlocks * sizeof(int));
+        if (grown == NULL) return -1;
+        c->dataBlocks = grown;
+        c->dataBlocksCap = numDataBlocks;
+      }
+      if (numDataBlocks > 0) memset(c->dataBlocks, 0, numDataBlocks * sizeof(int));
+
+      if (isDir) c->numDirs++; else c->numFiles++;
+      if (WalkBlocks(c, inumber, inp, c->dataBlocks, numDataBlocks) < 0) return -1;
+      if (isDir && ScanDirectory(c, inumber, size, c->dataBlocks, numDataBlocks) < 0) return -1;
+    }
+  }
+  return 0;
+}
+
+static void CheckLinkCounts(struct checker *c) {
+  for (int inumber = 1; inumber <= c->numInodes; inumber++) {
+    int allocated = (c->modes[inumber] & IALLOC) != 0;
+    int refs = c->refs[inumber];
+    if (!allocated) {
+      if (refs > 0) Report(c, "unallocated inode %d is named by %d directory entries", inumber, refs);
+    } else if (refs == 0) {
+      Report(c, "inode %d is allocated but no directory names it (orphan)", inumber);
+    } else if (refs != c->nlinks[inumber]) {
+      Report(c, "inode %d has link count %d but %d directory entries", inumber, c->nlinks[inumber], refs);
+    }
+  }
+
+  struct filsys *sb = &c->fs->superblock;
+  for (int i = 0; i < sb->s_ninode && i < NICFREE; i++) {
+    int inumber = sb->s_inode[i];
+    if (inumber < 1 || inumber > c->numInodes) {
+      Report(c, "free inode list holds out-of-range inode %d", inumber);
+    } else if (c->modes[inumber] & IALLOC) {
+      Report(c, "free inode list holds allocated inode %d", inumber);
+    }
+  }
+}
+
+/**
+ * Walks the free block chain starting at the superblock.
+ */
+static int CheckFreeList(struct checker *c) {
+  struct filsys *sb = &c->fs->superblock;
+  int nfree = sb->s_nfree;
+  uint16_t free[NICFREE];
+  memcpy(free, sb->s_free, sizeof(free));
+  int numFree = 0;
+
+  while (nfree > 0) {
+    if (nfree > NICFREE) {
+      Report(c, "free list has a bad count %d", nfree);
+      break;
+    }
+
+    for (int i = nfree - 1; i >= 0; i--) {
+      int blockNum = free[i];
+      if (i == 0 && blockNum == 0) break; // end of the chain
+      if (blockNum < INODE_START_SECTOR + sb->s_isize || blockNum >= c->numBlocks) {
+        Report(c, "free list holds out-of-range block %d", blockNum);
+        return 0;
+      }
+      if (c->owner[blockNum] == BLOCK_FREE) {
+        Report(c, "block %d appears on the free list more than once", blockNum);
+        return 0; // most likely a cycle in the chain
+      }
+      if (c->owner[blockNum] != BLOCK_UNCLAIMED) {
+        Report(c, "block %d is on the free list but used by inode %d", blockNum, c->owner[blockNum]);
+      } else {
+        c->owner[blockNum] = BLOCK_FREE;
+      }
+      numFree++;
+    }
+
+    if (free[0] == 0) break;
+    uint16_t chain[1 + NICFREE];
+    char buf[DISKIMG_SECTOR_SIZE];
+    if (unixfilesystem_readsector(c->fs, free[0], buf) != DISKIMG_SECTOR_SIZE) return -1;
+    memcpy(chain, buf, sizeof(chain));
+    nfree = chain[0];
+    memcpy(free, chain + 1, sizeof(free));
+  }
+
+  int numMissing = 0, firstMissing = 0;
+  for (int b = INODE_START_SECTOR + sb->s_isize; b < c->numBlocks; b++) {
+    if (c->owner[b] != BLOCK_UNCLAIMED) continue;
+    if (numMissing++ == 0) firstMissing = b;
+  }
+  if (numMissing > 0) {
+    Report(c, "%d blocks are neither in use nor on the free list (first is %d)", numMissing, firstMissing);
+  }
+  if (!c->quiet) {
+    fprintf(c->out, "%s: %d free blocks\n", c->name, numFree);
+  }
+  return 0;
+}
+
+/**
+ * Runs every check over the open filesystem.  Returns the exit status for
+ * the image.
+ */
+static int RunChecks(struct checker *c, int fd) {
+  struct filsys *sb = &c->fs->superblock;
+  c->numInodes = sb->s_isize * INODES_PER_SECTOR;
+  c->numBlocks = sb->s_fsize;
+  if (diskimg_getsize(fd) < c->numBlocks * DISKIMG_SECTOR_SIZE ||
+      c->numBlocks < INODE_START_SECTOR + sb->s_isize) {
+    fprintf(c->out, "%s: superblock sizes (s_isize %d, s_fsize %d) don't fit the image\n",
+            c->name, sb->s_isize, sb->s_fsize);
+    return EXIT_ERROR;
+  }
+
+  c->owner = calloc(c->numBlocks, sizeof(int));
+  c->modes = calloc(c->numInodes + 1, sizeof(uint16_t));
+  c->nlinks = calloc(c->numInodes + 1, sizeof(uint8_t));
+  c->refs = calloc(c->numInodes + 1, sizeof(int));
+  if (c->owner == NULL || c->modes == NULL || c->nlinks == NULL || c->refs == NULL) {
+    fprintf(c->out, "%s: out of memory\n", c->name);
+    return EXIT_ERROR;
+  }
+  for (int b = 0; b < INODE_START_SECTOR + sb->s_isize; b++) c->owner[b] = BLOCK_SYSTEM;
+
+  if (CheckInodes(c) < 0 || CheckFreeList(c) < 0) {
+    fprintf(c->out, "%s: error reading image\n", c->name);
+    return EXIT_ERROR;
+  }
+  CheckLinkCounts(c);
+
+  if (c->problems > 0) {
+    fprintf(c->out, "%s: %d problems\n", c->name, c->problems);
+    return EXIT_PROBLEMS;
+  }
+  fprintf(c->out, "%s: clean, %d files, %d directories, %d blocks\n",
+          c->name, c->numFiles, c->numDirs, c->numBlocks);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Checks a single image and prints its report in one write, so that reports
+ * of images checked in parallel don't interleave.  Returns the exit status
+ * for the image.
+ */
+static int CheckImage(char *diskpath, int quiet) {
+  char *report = NULL;
+  size_t reportSize = 0;
+  struct checker c;
+  memset(&c, 0, sizeof(c));
+  c.name = diskpath;
+  c.quiet = quiet;
+  c.out = open_memstream(&report, &reportSize);
+  if (c.out == NULL) return EXIT_ERROR;
+
+  int status = EXIT_ERROR;
+  int fd = diskimg_open(diskpath, 1);
+  if (fd < 0) {
+    fprintf(c.out, "%s: can't open image\n", diskpath);
+  } else {
+    c.fs = unixfilesystem_init(fd);
+    if (c.fs == NULL) {
+      fprintf(c.out, "%s: not a v6 filesystem\n", diskpath);
+    } else {
+      status = RunChecks(&c, fd);
+    }
+    free(c.owner);
+    free(c.modes);
+    free(c.nlinks);
+    free(c.refs);
+    free(c.dataBlocks);
+    unixfilesystem_free(c.fs);
+    diskimg_close(fd);
+  }
+
+  fclose(c.out);
+  if (write(STDOUT_FILENO, report, reportSize) < 0) status = EXIT_ERROR;
+  free(report);
+  return status;
+}
+
+static void PrintUsageAndExit(char *progname) {
+  fprintf(stderr, "Usage: %s <options> diskimagePath...\n", progname);
+  fprintf(stderr, "where <options> can be:\n");
+  fprintf(stderr, "-q       only report problems\n");
+  fprintf(stderr, "-j jobs  check at most this many images at once (default: one per CPU)\n");
+  exit(EXIT_FAILURE);
+}
@@ -0,0 +1,195 @@
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/**
+ * Checks that diskimageextract produces the same tree however many workers
+ * it runs.  The image is extracted once with a single worker, then again,
+ * run after run, with many workers, and each of those trees is compared
+ * against the first: the same directories and files, with the same contents,
+ * permission bits and modification times.  Workers that read through a shared
+ * file offset, say, show up here as files with the wrong blocks in them.
+ *
+ * The image should hold plenty of files spread over several directories,
+ * which diskimagepopulate (run on a scratch copy) can arrange:
+ *
+ *    > ./diskimagepopulate -f 200 -s 20000 -d /a scratch.img
+ *    > ./diskimagepopulate -f 200 -s 20000 -d /b scratch.img
+ *    > ./diskimageextract-test -j 8 -r 40 scratch.img
+ */
+
+static int numWorkers = 8;
+static int numRuns = 20;
+static char extractPath[4096];
+static const char *compareRoot; // the tree nftw is walking is checked against this one
+static const char *walkRoot;
+static int numDifferences;
+
+static int Extract(const char *diskpath, const char *destpath, int workers);
+static int CompareTrees(const char *expected, const char *actual);
+static void RemoveTree(const char *path);
+static void PrintUsageAndExit(char *progname);
+
+int main(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "j:r:")) != -1) {
+    switch (opt) {
+    case 'j':
+      numWorkers = atoi(optarg);
+      break;
+    case 'r':
+      numRuns = atoi(optarg);
+      break;
+    default:
+      PrintUsageAndExit(argv[0]);
+    }
+  }
+
+  if (optind != argc-1 || numWorkers < 1 || numRuns < 1) {
+    PrintUsageAndExit(argv[0]);
+  }
+
+  // diskimageextract is expected to sit beside this program
+  const char *slash = strrchr(argv[0], '/');
+  int dirLength = slash == NULL ? 0 : slash - argv[0] + 1;
+  snprintf(extractPath, sizeof(extractPath), "%.*sdiskimageextract", dirLength, argv[0]);
+
+  char serialDir[] = "/tmp/diskimageextract-test-XXXXXX";
+  char parallelDir[] = "/tmp/diskimageextract-test-XXXXXX";
+  if (mkdtemp(serialDir) == NULL || mkdtemp(parallelDir) == NULL) {
+    fprintf(stderr, "Can't create scratch directories in /tmp\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int numFailures = 0, numRunsDone = 0;
+  if (Extract(argv[optind], serialDir, 1) < 0) {
+    fprintf(stderr, "Extracting %s with 1 worker failed\n", argv[optind]);
+    numFailures++;
+  }
+  for (int run = 1; run <= numRuns && numFailures == 0; run++) {
+    RemoveTree(parallelDir);
+    numRunsDone++;
+    if (Extract(argv[optind], parallelDir, numWorkers) < 0) {
+      fprintf(stderr, "Run %d: extracting with %d workers failed\n", run, numWorkers);
+      numFailures++;
+    } else if (CompareTrees(serialDir, parallelDir) > 0) {
+      fprintf(stderr, "Run %d: the tree extracted with %d workers differs from the serial one\n", run, numWorkers);
+      numFailures++;
+    }
+  }
+
+  RemoveTree(serialDir);
+  RemoveTree(parallelDir);
+  printf("%s: %d run%s with %d workers, %d failed\n", numFailures == 0 ? "PASS" : "FAIL",
+         numRunsDone, numRunsDone == 1 ? "" : "s", numWorkers, numFailures);
+  exit(numFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+  return 0;
+}
+
+/**
+ * Runs diskimageextract on the image with the given number of workers,
+ * discarding what it prints.  Returns 0 if it succeeded, -1 otherwise.
+ */
+static int Extract(const char *diskpath, const char *destpath, int workers) {
+  char workerArg[16];
+  snprintf(workerArg, sizeof(workerArg), "%d", workers);
+  pid_t pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    freopen("/dev/null", "w", stdout);
+    execl(extractPath, extractPath, "-j", workerArg, diskpath, destpath, (char *) NULL);
+    fprintf(stderr, "Can't run %s\n", extractPath);
+    _exit(EXIT_FAILURE);
+  }
+
+  int status;
+  if (waitpid(pid, &status, 0) < 0) return -1;
+  return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS ? 0 : -1;
+}
+
+static int SameContents(const char *expected, const char *actual) {
+  FILE *a = fopen(expected, "r");
+  FILE *b = fopen(actual, "r");
+  int same = a != NULL && b != NULL;
+  while (same) {
+    int ca = getc(a), cb = getc(b);
+    if (ca != cb) same = 0;
+    if (ca == EOF) break;
+  }
+  if (a != NULL) fclose(a);
+  if (b != NULL) fclose(b);
+  return same;
+}
+
+/**
+ * nftw callback: checks the entry at path, which is under walkRoot, against
+ * the entry at the same relative path under compareRoot.
+ */
+static int CompareEntry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+  if (ftw->level == 0) return 0; // the roots are the scratch directories themselves
+  char other[4096];
+  snprintf(other, sizeof(other), "%s%s", compareRoot, path + strlen(walkRoot));
+  struct stat otherst;
+  const char *problem = NULL;
+  if (lstat(other, &otherst) < 0) problem = "is missing";
+  else if ((st->st_mode & S_IFMT) != (otherst.st_mode & S_IFMT)) problem = "is of a different type";
+  else if ((st->st_mode & 07777) != (otherst.st_mode & 07777)) problem = "has different permissions";
+  else if (S_ISREG(st->st_mode) && st->st_mtime != otherst.st_mtime) problem = "has a different modification time";
+  else if (S_ISREG(st->st_mode) && (st->st_size != otherst.st_size || !SameContents(path, other))) problem = "has different contents";
+  if (problem != NULL) {
+    if (numDifferences < 10) fprintf(stderr, "  %s %s\n", other, problem);
+    numDifferences++;
+  }
+  return 0;
+}
+
+/**
+ * Returns the number of entries in which the two trees differ, counting
+ * entries missing from either one.
+ */
+static int CompareTrees(const char *expected, const char *actual) {
+  numDifferences = 0;
+  walkRoot = expected;
+  compareRoot = actual;
+  nftw(expected, CompareEntry, 16, FTW_PHYS);
+  walkRoot = actual;      // and the other way round, for anything extra
+  compareRoot = expected;
+  nftw(actual, CompareEntry, 16, FTW_PHYS);
+  return numDifferences;
+}
+
+static int RemoveEntry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+  if (type == FTW_DP) rmdir(path);
+  else unlink(path);
+  return 0;
+}
+
+/**
+ * Removes the tree at path (diskimageextract creates its destination
+ * directory if need be).  Extracted directories may have lost their write
+ * permission, so every directory is made writable first.
+ */
+static int MakeWritable(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+  if (type == FTW_D) chmod(path, 0755);
+  return 0;
+}
+
+static void RemoveTree(const char *path) {
+  nftw(path, MakeWritable, 16, FTW_PHYS);
+  nftw(path, RemoveEntry, 16, FTW_PHYS | FTW_DEPTH);
+}
+
+static void PrintUsageAndExit(char *progname) {
+  fprintf(stderr, "Usage: %s <options> diskimagePath\n", progname);
+  fprintf(stderr, "where <options> can be:\n");
+  fprintf(stderr, "-j workers  number of workers for the parallel runs (default: 8)\n");
+  fprintf(stderr, "-r runs     number of parallel runs (default: 20)\n");
+  exit(EXIT_FAILURE);
+}
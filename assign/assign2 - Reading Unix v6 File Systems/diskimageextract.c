@@ -0,0 +1,388 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "diskimg.h"
+#include "unixfilesystem.h"
+#include "inode.h"
+#include "direntv6.h"
+
+/**
+ * Copies every directory and regular file of a disk image out to a directory
+ * on the host, preserving permission bits and modification times.
+ *
+ * The directory tree is walked once, up front, reading each directory's
+ * blocks directly; host directories are created along the way and the files
+ * of each directory are gathered into one unit of work.  A pool of worker
+ * processes then pulls units off a pipe.  A worker fetches each file's block
+ * list once and copies runs of adjacent blocks with a single large read and
+ * write apiece, instead of looking up and reading the file a block at a time.
+ */
+
+#define ENTRIES_PER_BLOCK (DISKIMG_SECTOR_SIZE / sizeof(struct direntv6))
+#define MAX_RUN_SECTORS 256
+
+struct fileitem {
+  int inumber;
+  char *path;              // host path
+};
+
+struct diritem {
+  char *path;              // host path
+  struct inode ino;        // mode and times are applied once extraction finishes
+  int firstFile;           // this directory's files are files[firstFile, firstFile + numFiles)
+  int numFiles;
+};
+
+static struct fileitem *files;
+static int numFiles, filesCap;
+static struct diritem *dirs;
+static int numDirs, dirsCap;
+static long long totalBytes;
+static int numSkipped;
+static uint8_t *visited;   // per inumber, guards against directory cycles
+
+static int numWorkers = 0;
+
+static int WalkDirectory(struct unixfilesystem *fs, int inumber, const char *path);
+static int RunWorkers(struct unixfilesystem *fs);
+static void FinishDirectories(void);
+static void PrintUsageAndExit(char *progname);
+static double Now(void);
+
+int main(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    switch (opt) {
+    case 'j':
+      numWorkers = atoi(optarg);
+      break;
+    default:
+      PrintUsageAndExit(argv[0]);
+    }
+  }
+
+  if (optind != argc-2 || numWorkers < 0) {
+    PrintUsageAndExit(argv[0]);
+  }
+  if (numWorkers == 0) numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  char *diskpath = argv[optind];
+  char *destpath = argv[optind + 1];
+  int fd = diskimg_open(diskpath, 1);
+  if (fd < 0) {
+    fprintf(stderr, "Can't open diskimagePath %s\n", diskpath);
+    exit(EXIT_FAILURE);
+  }
+
+  struct unixfilesystem *fs = unixfilesystem_init(fd);
+  if (!fs) {
+    fprintf(stderr, "Failed to initialize unix filesystem\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int numInodes = fs->superblock.s_isize * (DISKIMG_SECTOR_SIZE / sizeof(struct inode));
+  visited = calloc(numInodes + 1, 1);
+  if (visited == NULL) {
+    fprintf(stderr, "Out of memory.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  double start = Now();
+  if (mkdir(destpath, 0755) < 0 && errno != EEXIST) {
+    fprintf(stderr, "Can't create %s\n", destpath);
+    exit(EXIT_FAILURE);
+  }
+  int status = EXIT_SUCCESS;
+  if (WalkDirectory(fs, ROOT_INUMBER, destpath) < 0) status = EXIT_FAILURE;
+  double walked = Now();
+  if (RunWorkers(fs) < 0) status = EXIT_FAILURE;
+  FinishDirectories();
+  double elapsed = Now() - start;
+
+  printf("Extracted %d files (%lld bytes) in %d directories with %d workers\n",
+         numFiles, totalBytes, numDirs, numWorkers);
+  if (numSkipped > 0) printf("Skipped %d device files\n", numSkipped);
+  printf("Elapsed %.3f seconds (%.3f walking the tree), %.2f MB/s\n", elapsed, walked - start,
+         elapsed > 0 ? totalBytes / elapsed / (1024 * 1024) : 0.0);
+
+  unixfilesystem_free(fs);
+  diskimg_close(fd);
+  exit(status);
+  return 0;
+}
+
+static char *JoinPath(const char *dir, const char *name) {
+  char *path = malloc(strlen(dir) + strlen(name) + 2);
+  if (path != NULL) sprintf(path, "%s/%s", dir, name);
+  return path;
+}
+
+static time_t V6Time(const uint16_t t[2]) {
+  return ((time_t) t[0] << 16) | t[1];
+}
+
+/**
+ * Reads the block list of the file with the given inode into a freshly
+ * allocated array, which the caller frees.  Returns NULL on error.
+ */
+static uint16_t *GetBlockList(struct unixfilesystem *fs, struct inode *inp, int *numBlocks) {
+  *numBlocks = (inode_getsize(inp) + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+  uint16_t *blocks = malloc((*numBlocks + 1) * sizeof(uint16_t));
+  if (blocks == NULL) return NULL;
+  if (inode_getblocklist(fs, inp, blocks) != *numBlocks) {
+    free(blocks);
+    return NULL;
+  }
+  return blocks;
+}
+
+/**
+ * Records the directory, gathers its regular files into one unit of work
+ * and recurses into its subdirectories, creating each on the host first.
+ * Returns 0 on success, -1 if anything could not be read or created.
+ */
+static int WalkDirectory(struct unixfilesystem *fs, int inumber, const char *path) {
+  struct inode dino;
+  if (inode_iget(fs, inumber, &dino) < 0 || (dino.i_mode & IFMT) != IFDIR) {
+    fprintf(stderr, "Inode %d (%s) isn't a readable directory\n", inumber, path);
+    return -1;
+  }
+  visited[inumber] = 1;
+
+  if (numDirs == dirsCap) {
+    dirsCap = dirsCap == 0 ? 64 : dirsCap * 2;
+    dirs = realloc(dirs, dirsCap * sizeof(struct diritem));
+    if (dirs == NULL) return -1;
+  }
+  int d = numDirs++;
+  dirs[d].path = strdup(path);
+  dirs[d].ino = dino;
+  dirs[d].firstFile = numFiles;
+  dirs[d].numFiles = 0;
+
+  int numBlocks;
+  uint16_t *blocks = GetBlockList(fs, &dino, &numBlocks);
+  if (blocks == NULL) return -1;
+
+  // Subdirectories are walked after every file here has been gathered, so
+  // that this directory's files stay contiguous in files[].
+  int *subdirs = NULL;
+  char (*subnames)[sizeof(((struct direntv6 *) 0)->d_name) + 1] = NULL;
+  int numSubdirs = 0, subdirsCap = 0;
+  int err = 0;
+  int size = inode_getsize(&dino);
+  for (int b = 0; b < numBlocks && err == 0; b++) {
+    struct direntv6 entries[ENTRIES_PER_BLOCK];
+    if (blocks[b] == 0 || unixfilesystem_readsector(fs, blocks[b], entries) != DISKIMG_SECTOR_SIZE) {
+      err = -1;
+      break;
+    }
+    int bytes = size - b * DISKIMG_SECTOR_SIZE;
+    int numEntries = (bytes > DISKIMG_SECTOR_SIZE ? DISKIMG_SECTOR_SIZE : bytes) / sizeof(struct direntv6);
+    for (int e = 0; e < numEntries; e++) {
+      struct direntv6 *ent = &entries[e];
+      if (ent->d_inumber == 0) continue;
+      char name[sizeof(ent->d_name) + 1];
+      memcpy(name, ent->d_name, sizeof(ent->d_name));
+      name[sizeof(ent->d_name)] = '\0';
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+      struct inode ino;
+      if (inode_iget(fs, ent->d_inumber, &ino) < 0 || (ino.i_mode & IALLOC) == 0) {
+        fprintf(stderr, "Entry %s/%s names a bad inode %d\n", path, name, ent->d_inumber);
+        err = -1;
+        continue;
+      }
+
+      if ((ino.i_mode & IFMT) == IFDIR) {
+        if (visited[ent->d_inumber]) continue;
+        if (numSubdirs == subdirsCap) {
+          subdirsCap = subdirsCap == 0 ? 16 : subdirsCap * 2;
+          subdirs = realloc(subdirs, subdirsCap * sizeof(int));
+          subnames = realloc(subnames, subdirsCap * sizeof(*subnames));
+          if (subdirs == NULL || subnames == NULL) return -1;
+        }
+        subdirs[numSubdirs] = ent->d_inumber;
+        strcpy(subnames[numSubdirs], name);
+        numSubdirs++;
+      } else if ((ino.i_mode & IFMT) == 0) {
+        if (numFiles == filesCap) {
+          filesCap = filesCap == 0 ? 256 : filesCap * 2;
+          files = realloc(files, filesCap * sizeof(struct fileitem));
+          if (files == NULL) return -1;
+        }
+        files[numFiles].inumber = ent->d_inumber;
+        files[numFiles].path = JoinPath(path, name);
+        numFiles++;
+        dirs[d].numFiles++;
+        totalBytes += inode_getsize(&ino);
+      } else {
+        numSkipped++;
+      }
+    }
+  }
+  free(blocks);
+
+  for (int i = 0; i < numSubdirs; i++) {
+    char *subpath = JoinPath(path, subnames[i]);
+    if (subpath == NULL || (mkdir(subpath, 0755) < 0 && errno != EEXIST)) {
+      fprintf(stderr, "Can't create %s\n", subpath);
+      err = -1;
+    } else if (WalkDirectory(fs, subdirs[i], subpath) < 0) {
+      err = -1;
+    }
+    free(subpath);
+  }
+  free(subdirs);
+  free(subnames);
+  return err;
+}
+
+/**
+ * Writes all len bytes of buf to fd.  Returns 0 on success, -1 on error.
+ */
+static int WriteAll(int fd, const char *buf, int len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/**
+ * Copies one file out of the image, a run of adjacent blocks at a time.
+ * Holes come out as zeros.  Returns 0 on success, -1 on error.
+ */
+static int ExtractFile(struct unixfilesystem *fs, struct fileitem *item, char *run) {
+  struct inode ino;
+  if (inode_iget(fs, item->inumber, &ino) < 0) return -1;
+  int numBlocks;
+  uint16_t *blocks = GetBlockList(fs, &ino, &numBlocks);
+  if (blocks == NULL) return -1;
+
+  int out = open(item->path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (out < 0) {
+    free(blocks);
+    return -1;
+  }
+
+  int size = inode_getsize(&ino);
+  int err = 0;
+  for (int b = 0; b < numBlocks && err == 0; ) {
+    int len = 1;
+    if (blocks[b] == 0) {
+      while (b + len < numBlocks && len < MAX_RUN_SECTORS && blocks[b + len] == 0) len++;
+      memset(run, 0, len * DISKIMG_SECTOR_SIZE);
+    } else {
+      while (b + len < numBlocks && len < MAX_RUN_SECTORS && blocks[b + len] == blocks[b] + len) len++;
+      if (diskimg_readsectors(fs->dfd, blocks[b], len, run) != len * DISKIMG_SECTOR_SIZE) err = -1;
+    }
+
+    int bytes = size - b * DISKIMG_SECTOR_SIZE;
+    if (bytes > len * DISKIMG_SECTOR_SIZE) bytes = len * DISKIMG_SECTOR_SIZE;
+    if (err == 0 && WriteAll(out, run, bytes) < 0) err = -1;
+    b += len;
+  }
+  free(blocks);
+
+  struct timeval times[2] = {{ V6Time(ino.i_atime), 0 }, { V6Time(ino.i_mtime), 0 }};
+  if (err == 0 && (fchmod(out, ino.i_mode & 0777) < 0 || futimes(out, times) < 0)) err = -1;
+  if (close(out) < 0) err = -1;
+  return err;
+}
+
+/**
+ * Body of a worker process: extracts the files of every directory whose
+ * index arrives on the pipe until the pipe is closed.
+ */
+static int Worker(struct unixfilesystem *fs, int unitfd) {
+  char *run = malloc(MAX_RUN_SECTORS * DISKIMG_SECTOR_SIZE);
+  if (run == NULL) return EXIT_FAILURE;
+
+  int status = EXIT_SUCCESS;
+  int d;
+  while (read(unitfd, &d, sizeof(d)) == sizeof(d)) {
+    for (int f = dirs[d].firstFile; f < dirs[d].firstFile + dirs[d].numFiles; f++) {
+      if (ExtractFile(fs, &files[f], run) < 0) {
+        fprintf(stderr, "Can't extract %s\n", files[f].path);
+        status = EXIT_FAILURE;
+      }
+    }
+  }
+  free(run);
+  return status;
+}
+
+/**
+ * Forks the worker pool and feeds it one directory index per unit of work.
+ * Each index is a single int-sized write, so workers never see a partial
+ * one.  Returns 0 if every worker succeeded, -1 otherwise.
+ */
+static int RunWorkers(struct unixfilesystem *fs) {
+  int fds[2];
+  if (pipe(fds) < 0) return -1;
+  fflush(stdout);
+
+  int err = 0;
+  for (int i = 0; i < numWorkers; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[1]);
+      exit(Worker(fs, fds[0]));
+    }
+    if (pid < 0) err = -1;
+  }
+  close(fds[0]);
+
+  for (int d = 0; d < numDirs; d++) {
+    if (dirs[d].numFiles == 0) continue;
+    if (write(fds[1], &d, sizeof(d)) != sizeof(d)) err = -1;
+  }
+  close(fds[1]);
+
+  int status;
+  while (wait(&status) > 0) {
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) err = -1;
+  }
+  return err;
+}
+
+/**
+ * Gives each directory its mode and times from the image.  This happens last
+ * and deepest first, since creating entries updates a directory's mtime and
+ * a read-only mode would keep its entries from being created at all.
+ */
+static void FinishDirectories(void) {
+  for (int d = numDirs - 1; d >= 0; d--) {
+    struct timeval times[2] = {{ V6Time(dirs[d].ino.i_atime), 0 }, { V6Time(dirs[d].ino.i_mtime), 0 }};
+    if (d > 0) chmod(dirs[d].path, dirs[d].ino.i_mode & 0777);
+    utimes(dirs[d].path, times);
+  }
+}
+
+static double Now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void PrintUsageAndExit(char *progname) {
+  fprintf(stderr, "Usage: %s <options> diskimagePath destDir\n", progname);
+  fprintf(stderr, "where <options> can be:\n");
+  fprintf(stderr, "-j workers  number of worker processes (default: one per CPU)\n");
+  exit(EXIT_FAILURE);
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include "diskimg.h"
+#include "unixfilesystem.h"
+#include "inode.h"
+#include "file.h"
+#include "pathname.h"
+
+/**
+ * Bulk-populates a disk image with files and reports the write throughput,
+ * either through the write-back buffer cache or, with -n, with every sector
+ * going straight to the disk image as it is written.  The image is modified,
+ * so run this on a scratch copy.
+ */
+
+static int naiveFlag = 0;
+static int numBuffers = 4096;
+static int numFiles = 100;
+static int fileSize = 64 * 1024;
+static int writeSize = 1000;     // deliberately not a multiple of the sector size
+static const char *dirPath = "/populate";
+
+static void PrintUsageAndExit(char *progname);
+static double Now(void);
+
+int main(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "nb:f:s:w:d:")) != -1) {
+    switch (opt) {
+    case 'n':
+      naiveFlag = 1;
+      break;
+    case 'b':
+      numBuffers = atoi(optarg);
+      break;
+    case 'f':
+      numFiles = atoi(optarg);
+      break;
+    case 's':
+      fileSize = atoi(optarg);
+      break;
+    case 'w':
+      writeSize = atoi(optarg);
+      break;
+    case 'd':
+      dirPath = optarg;
+      break;
+    default:
+      PrintUsageAndExit(argv[0]);
+    }
+  }
+
+  if (optind != argc-1 || numBuffers < 1 || numFiles < 0 || fileSize < 0 || writeSize < 1) {
+    PrintUsageAndExit(argv[0]);
+  }
+
+  char *diskpath = argv[optind];
+  int fd = diskimg_open(diskpath, 0);
+  if (fd < 0) {
+    fprintf(stderr, "Can't open diskimagePath %s\n", diskpath);
+    exit(EXIT_FAILURE);
+  }
+
+  struct unixfilesystem *fs = unixfilesystem_init(fd);
+  if (!fs) {
+    fprintf(stderr, "Failed to initialize unix filesystem\n");
+    exit(EXIT_FAILURE);
+  }
+  if (!naiveFlag && unixfilesystem_attachcache(fs, numBuffers) < 0) {
+    fprintf(stderr, "Failed to allocate a buffer cache of %d sectors\n", numBuffers);
+    exit(EXIT_FAILURE);
+  }
+
+  char *chunk = malloc(writeSize);
+  if (chunk == NULL) {
+    fprintf(stderr, "Out of memory.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  double start = Now();
+  if (pathname_create(fs, dirPath, IFDIR | 0755) < 0) {
+    fprintf(stderr, "Can't create directory %s\n", dirPath);
+    exit(EXIT_FAILURE);
+  }
+
+  long long bytesWritten = 0;
+  int status = EXIT_SUCCESS;
+  for (int i = 0; i < numFiles && status == EXIT_SUCCESS; i++) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/f%05d", dirPath, i);
+    int inumber = pathname_create(fs, path, 0644);
+    if (inumber < 0) {
+      fprintf(stderr, "Can't create %s\n", path);
+      status = EXIT_FAILURE;
+      break;
+    }
+
+    for (int offset = 0; offset < fileSize; offset += writeSize) {
+      int len = fileSize - offset < writeSize ? fileSize - offset : writeSize;
+      for (int j = 0; j < len; j++) chunk[j] = (char) (i + offset + j);
+      if (file_append(fs, inumber, chunk, len) != len) {
+        fprintf(stderr, "Can't append to %s (filesystem full?)\n", path);
+        status = EXIT_FAILURE;
+        break;
+      }
+      bytesWritten += len;
+    }
+  }
+
+  if (unixfilesystem_sync(fs) < 0) {
+    fprintf(stderr, "Error syncing %s\n", diskpath);
+    status = EXIT_FAILURE;
+  }
+  double elapsed = Now() - start;
+
+  if (naiveFlag) {
+    printf("Mode: naive sector-at-a-time writes\n");
+  } else {
+    printf("Mode: write-back cache of %d sectors\n", numBuffers);
+  }
+  printf("Wrote %lld bytes in %d files of %d bytes (%d-byte appends)\n",
+         bytesWritten, numFiles, fileSize, writeSize);
+  printf("Elapsed %.3f seconds, %.2f MB/s\n", elapsed,
+         elapsed > 0 ? bytesWritten / elapsed / (1024 * 1024) : 0.0);
+
+  free(chunk);
+  unixfilesystem_free(fs);
+  if (diskimg_close(fd) < 0) fprintf(stderr, "Error closing %s\n", diskpath);
+  exit(status);
+  return 0;
+}
+
+static double Now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void PrintUsageAndExit(char *progname) {
+  fprintf(stderr, "Usage: %s <options> diskimagePath\n", progname);
+  fprintf(stderr, "where <options> can be:\n");
+  fprintf(stderr, "-n        write each sector straight to the disk (no buffer cache)\n");
+  fprintf(stderr, "-b bufs   buffer cache size in sectors (default %d)\n", numBuffers);
+  fprintf(stderr, "-f files  number of files to create (default %d)\n", numFiles);
+  fprintf(stderr, "-s size   size of each file in bytes (default %d)\n", fileSize);
+  fprintf(stderr, "-w size   bytes per append (default %d)\n", writeSize);
+  fprintf(stderr, "-d dir    directory to create the files in (default %s)\n", dirPath);
+  exit(EXIT_FAILURE);
+}
@@ -4,6 +4,7 @@
 #include <unistd.h>
 
 #include "diskimg.h"
+#include "fsstats.h"
 
 int diskimg_open(char *pathname, int readOnly) {
   return open(pathname, readOnly ? O_RDONLY : O_RDWR);
@@ -13,17 +14,31 @@ int diskimg_getsize(int fd) {
   return lseek(fd, 0, SEEK_END);
 }
 
+// pread and pwrite leave the descriptor's file offset alone, so processes
+// forked with the image open (diskimageextract's workers, say) don't move
+// each other's reads and writes to the wrong sectors
 int diskimg_readsector(int fd, int sectorNum,  void *buf) {
-  if (lseek(fd, sectorNum * DISKIMG_SECTOR_SIZE, SEEK_SET) == (off_t) -1) return -1;  
-  return read(fd, buf, DISKIMG_SECTOR_SIZE);
+  int bytes = pread(fd, buf, DISKIMG_SECTOR_SIZE, (off_t) sectorNum * DISKIMG_SECTOR_SIZE);
+  if (bytes > 0) fsstats.sectorsRead++;
+  return bytes;
+}
+
+int diskimg_readsectors(int fd, int sectorNum, int numSectors, void *buf) {
+  int bytes = pread(fd, buf, numSectors * DISKIMG_SECTOR_SIZE, (off_t) sectorNum * DISKIMG_SECTOR_SIZE);
+  if (bytes > 0) fsstats.sectorsRead += bytes / DISKIMG_SECTOR_SIZE;
+  return bytes;
 }
 
 int diskimg_writesector(int fd, int sectorNum,  void *buf) {
-  if (lseek(fd, sectorNum * DISKIMG_SECTOR_SIZE, SEEK_SET) == (off_t) -1) {
-    return -1;
-  }
+  int bytes = pwrite(fd, buf, DISKIMG_SECTOR_SIZE, (off_t) sectorNum * DISKIMG_SECTOR_SIZE);
+  if (bytes > 0) fsstats.sectorsWritten++;
+  return bytes;
+}
 
-  return write(fd, buf, DISKIMG_SECTOR_SIZE);
+int diskimg_writesectors(int fd, int sectorNum, int numSectors, void *buf) {
+  int bytes = pwrite(fd, buf, numSectors * DISKIMG_SECTOR_SIZE, (off_t) sectorNum * DISKIMG_SECTOR_SIZE);
+  if (bytes > 0) fsstats.sectorsWritten += bytes / DISKIMG_SECTOR_SIZE;
+  return bytes;
 }
 
 int diskimg_close(int fd) {
@@ -23,12 +23,24 @@ int diskimg_getsize(int fd);
  */
 int diskimg_readsector(int fd, int sectorNum, void *buf); 
 
+/**
+ * Reads numSectors consecutive sectors, starting at sectorNum, into buf in a
+ * single request.  Returns the number of bytes read, or -1 on error.
+ */
+int diskimg_readsectors(int fd, int sectorNum, int numSectors, void *buf);
+
 /**
  * Writes the specified sector from the disk.  Returns the number of bytes
  * written, or -1 on error.
  */
 int diskimg_writesector(int fd, int sectorNum, void *buf); 
 
+/**
+ * Writes numSectors consecutive sectors, starting at sectorNum, from buf in a
+ * single request.  Returns the number of bytes written, or -1 on error.
+ */
+int diskimg_writesectors(int fd, int sectorNum, int numSectors, void *buf);
+
 /**
  * Clean up from a previous diskimg_open() call.  Returns 0 on success, or -1 on
  * error.
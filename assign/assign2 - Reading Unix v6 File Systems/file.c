@@ -1,15 +1,20 @@
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <time.h>
 
 #include "file.h"
 #include "inode.h"
 #include "diskimg.h"
+#include "fsstats.h"
 
 /**
  * Fetches the specified file block from the specified inode.
  * Returns the number of valid bytes in the block, -1 on error.
  */
 int file_getblock(struct unixfilesystem *fs, int inumber, int blockNum, void *buf) {
+	fsstats.fileBlocks++;
+
 	// get inode content
 	struct inode my_inode;
 	int err = inode_iget(fs, inumber, &my_inode);
@@ -20,7 +25,7 @@ int file_getblock(struct unixfilesystem *fs, int inumber, int blockNum, void *bu
 	if(sector < 0) return -1;
 
 	// get block content
-	int read_err = diskimg_readsector(fs->dfd, sector, buf);
+	int read_err = unixfilesystem_readsector(fs, sector, buf);
 	if(read_err < 0) return -1;
 
 	// get bytes and blocks
@@ -33,3 +38,79 @@ int file_getblock(struct unixfilesystem *fs, int inumber, int blockNum, void *bu
 		return DISKIMG_SECTOR_SIZE;
 	}
 }
+
+
+// Largest size the 24-bit i_size0/i_size1 pair can record.
+#define MAX_FILE_SIZE 0xffffff
+
+/**
+ * Appends len bytes from buf to the end of the specified file.
+ * Returns the number of bytes appended, -1 on error.
+ */
+int file_append(struct unixfilesystem *fs, int inumber, const void *buf, int len) {
+	struct inode my_inode;
+	if(inode_iget(fs, inumber, &my_inode) < 0) return -1;
+	if((my_inode.i_mode & IALLOC) == 0) return -1;
+
+	int size = inode_getsize(&my_inode);
+	if(len < 0 || size + len > MAX_FILE_SIZE) return -1;
+
+	// fill the tail of the last block, then whole blocks
+	const char *src = buf;
+	int written = 0;
+	while(written < len) {
+		int offset = size % DISKIMG_SECTOR_SIZE;
+		int chunk = DISKIMG_SECTOR_SIZE - offset;
+		if(chunk > len - written) chunk = len - written;
+
+		int sector = inode_indexalloc(fs, &my_inode, size / DISKIMG_SECTOR_SIZE);
+		if(sector < 0) break;
+		char block[DISKIMG_SECTOR_SIZE];
+		if(chunk < DISKIMG_SECTOR_SIZE) {
+			// partial block: keep what is already there
+			if(unixfilesystem_readsector(fs, sector, block) < 0) break;
+		}
+		memcpy(block + offset, src + written, chunk);
+		if(unixfilesystem_writesector(fs, sector, block) < 0) break;
+
+		written += chunk;
+		size += chunk;
+	}
+
+	// record whatever made it, even on a partial failure
+	time_t now = time(NULL);
+	my_inode.i_mtime[0] = now >> 16;
+	my_inode.i_mtime[1] = now & 0xffff;
+	inode_setsize(&my_inode, size);
+	if(inode_iput(fs, inumber, &my_inode) < 0) return -1;
+	return written == len ? written : -1;
+}
+
+
+/**
+ * Sets the size of the specified file, freeing or zero-filling as needed.
+ * Returns 0 on success, -1 on error.
+ */
+int file_truncate(struct unixfilesystem *fs, int inumber, int size) {
+	struct inode my_inode;
+	if(inode_iget(fs, inumber, &my_inode) < 0) return -1;
+	if((my_inode.i_mode & IALLOC) == 0) return -1;
+
+	int old_size = inode_getsize(&my_inode);
+	if(size < 0 || size > MAX_FILE_SIZE) return -1;
+	if(size > old_size) {
+		char zeros[DISKIMG_SECTOR_SIZE];
+		memset(zeros, 0, sizeof(zeros));
+		for(int left = size - old_size; left > 0; left -= DISKIMG_SECTOR_SIZE) {
+			int chunk = left < DISKIMG_SECTOR_SIZE ? left : DISKIMG_SECTOR_SIZE;
+			if(file_append(fs, inumber, zeros, chunk) < 0) return -1;
+		}
+		return 0;
+	}
+
+	if(inode_truncate(fs, &my_inode, size) < 0) return -1;
+	time_t now = time(NULL);
+	my_inode.i_mtime[0] = now >> 16;
+	my_inode.i_mtime[1] = now & 0xffff;
+	return inode_iput(fs, inumber, &my_inode);
+}
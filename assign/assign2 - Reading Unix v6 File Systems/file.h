@@ -9,4 +9,17 @@
  */
 int file_getblock(struct unixfilesystem *fs, int inumber, int blockNo, void *buf); 
 
+/**
+ * Appends len bytes from buf to the end of the specified file, allocating
+ * blocks as needed, and updates its size and modification time.
+ * Returns the number of bytes appended, -1 on error.
+ */
+int file_append(struct unixfilesystem *fs, int inumber, const void *buf, int len);
+
+/**
+ * Sets the size of the specified file.  Shrinking frees the blocks past the
+ * new end; growing appends zero bytes.  Returns 0 on success, -1 on error.
+ */
+int file_truncate(struct unixfilesystem *fs, int inumber, int size);
+
 #endif // _FILE_H_
@@ -0,0 +1,24 @@
+#include <string.h>
+
+#include "fsstats.h"
+
+struct fsstats fsstats;
+
+void fsstats_reset(void) {
+  memset(&fsstats, 0, sizeof(fsstats));
+}
+
+void fsstats_print(FILE *f) {
+  fprintf(f, "diskimg     sectors read %ld, sectors written %ld\n",
+          fsstats.sectorsRead, fsstats.sectorsWritten);
+  fprintf(f, "bufcache    hits %ld, misses %ld\n", fsstats.cacheHits, fsstats.cacheMisses);
+  fprintf(f, "inode       fetches %ld, indirect block fetches %ld\n",
+          fsstats.inodeFetches, fsstats.indirectFetches);
+  fprintf(f, "file        blocks fetched %ld\n", fsstats.fileBlocks);
+  fprintf(f, "directory   lookups %ld, blocks scanned %ld\n",
+          fsstats.dirLookups, fsstats.dirBlocksScanned);
+  fprintf(f, "pathname    lookups %ld, components resolved %ld\n",
+          fsstats.pathLookups, fsstats.pathComponents);
+  fprintf(f, "chksumfile  files hashed %ld, bytes hashed %ld\n",
+          fsstats.filesHashed, fsstats.bytesHashed);
+}
@@ -0,0 +1,46 @@
+#ifndef _FSSTATS_H_
+#define _FSSTATS_H_
+
+#include <stdio.h>
+
+/**
+ * Counters of the work done by each layer of the filesystem stack, so that
+ * I/O amplification can be pinned on the layer causing it.  Every layer
+ * bumps its own counters as it goes; nothing here changes behavior.
+ */
+struct fsstats {
+  // diskimg
+  long sectorsRead;         // sectors actually read from the image
+  long sectorsWritten;      // sectors actually written to the image
+  // bufcache
+  long cacheHits;
+  long cacheMisses;
+  // inode
+  long inodeFetches;        // inode_iget calls
+  long indirectFetches;     // indirect blocks read to map file blocks
+  // file
+  long fileBlocks;          // file_getblock calls
+  // directory
+  long dirLookups;          // directory_findname calls
+  long dirBlocksScanned;    // directory blocks searched by any directory operation
+  // pathname
+  long pathLookups;         // pathname_lookup calls
+  long pathComponents;      // components resolved by those lookups
+  // chksumfile
+  long filesHashed;
+  long bytesHashed;
+};
+
+extern struct fsstats fsstats;
+
+/**
+ * Zeroes every counter.
+ */
+void fsstats_reset(void);
+
+/**
+ * Prints every counter, one per line, to f.
+ */
+void fsstats_print(FILE *f);
+
+#endif // _FSSTATS_H_
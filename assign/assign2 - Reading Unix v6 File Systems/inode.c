@@ -1,16 +1,23 @@
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 #include "inode.h"
 #include "diskimg.h"
+#include "alloc.h"
+#include "fsstats.h"
 
 #define INDIR_ADDR 7
+#define ADDRS_PER_BLOCK (DISKIMG_SECTOR_SIZE / sizeof(uint16_t))
+#define MAX_FILE_BLOCKS (INDIR_ADDR * ADDRS_PER_BLOCK + ADDRS_PER_BLOCK * ADDRS_PER_BLOCK)
 
 /**
  * Fetches the specified inode from the filesystem. 
  * Returns 0 on success, -1 on error.  
  */
 int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp) {
+	fsstats.inodeFetches++;
+
 	// get offset of sector and inumber
 	inumber = inumber - 1;		// inumber starts from 1
 	int inode_num = DISKIMG_SECTOR_SIZE / sizeof(struct inode);
@@ -18,9 +25,8 @@ int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp) {
 	int inumber_offset = inumber % inode_num;
 
 	// get contents of a sector
-	int fd = fs->dfd;
 	struct inode inodes[inode_num];
-	int err = diskimg_readsector(fd, INODE_START_SECTOR + sector_offset, inodes);
+	int err = unixfilesystem_readsector(fs, INODE_START_SECTOR + sector_offset, inodes);
 	if(err < 0) return -1;
 	
 	// get contents of an inode
@@ -38,7 +44,6 @@ int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp) {
  * Returns the disk block number on success, -1 on error.  
  */
 int inode_indexlookup(struct unixfilesystem *fs, struct inode *inp, int blockNum) {
-	int fd = fs->dfd;
 	int is_small_file = ((inp->i_mode & ILARG) == 0);
 
 	// if it is a small file
@@ -53,7 +58,8 @@ int inode_indexlookup(struct unixfilesystem *fs, struct inode *inp, int blockNum
 		int sector_offset = blockNum / addr_num;
 		int addr_offset = blockNum % addr_num;
 		uint16_t addrs[addr_num];
-		int err = diskimg_readsector(fd, inp->i_addr[sector_offset], addrs);
+		fsstats.indirectFetches++;
+		int err = unixfilesystem_readsector(fs, inp->i_addr[sector_offset], addrs);
 		if(err < 0) return -1;	
 		return addrs[addr_offset];
 	} else {							// if it also uses the DOUBLE_INDIR_ADDR
@@ -62,23 +68,243 @@ int inode_indexlookup(struct unixfilesystem *fs, struct inode *inp, int blockNum
 		int sector_offset_1 = INDIR_ADDR;
 		int addr_offset_1 = blockNum_in_double / addr_num;
 		uint16_t addrs_1[addr_num];
-		int err_1 = diskimg_readsector(fd, inp->i_addr[sector_offset_1], addrs_1);
+		fsstats.indirectFetches += 2;
+		int err_1 = unixfilesystem_readsector(fs, inp->i_addr[sector_offset_1], addrs_1);
 		if(err_1 < 0) return -1;
 
 		// the second layer
 		int sector_2 = addrs_1[addr_offset_1];
 		int addr_offset_2 = blockNum_in_double % addr_num;
 		uint16_t addrs_2[addr_num];
-		int err_2 = diskimg_readsector(fd, sector_2, addrs_2);
+		int err_2 = unixfilesystem_readsector(fs, sector_2, addrs_2);
 		if(err_2 < 0) return -1;
 		return addrs_2[addr_offset_2];
 	}	
 }
 
 
+/**
+ * Stores the disk block number of every block of the file in blocks.
+ * Returns the number of blocks stored on success, -1 on error.
+ */
+int inode_getblocklist(struct unixfilesystem *fs, struct inode *inp, uint16_t *blocks) {
+	int num_blocks = (inode_getsize(inp) + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+	int num_direct = sizeof(inp->i_addr) / sizeof(inp->i_addr[0]);
+	if(num_blocks > (int) MAX_FILE_BLOCKS) return -1;
+
+	// small file: everything is in i_addr
+	if((inp->i_mode & ILARG) == 0) {
+		if(num_blocks > num_direct) return -1;
+		memcpy(blocks, inp->i_addr, num_blocks * sizeof(uint16_t));
+		return num_blocks;
+	}
+
+	// large file: copy whole indirect blocks at a time
+	uint16_t addrs[ADDRS_PER_BLOCK];
+	int stored = 0;
+	for(int i = 0; i < INDIR_ADDR && stored < num_blocks; i++) {
+		int count = num_blocks - stored < (int) ADDRS_PER_BLOCK ? num_blocks - stored : (int) ADDRS_PER_BLOCK;
+		if(inp->i_addr[i] == 0) {
+			memset(blocks + stored, 0, count * sizeof(uint16_t));
+		} else {
+			fsstats.indirectFetches++;
+			if(unixfilesystem_readsector(fs, inp->i_addr[i], addrs) < 0) return -1;
+			memcpy(blocks + stored, addrs, count * sizeof(uint16_t));
+		}
+		stored += count;
+	}
+	if(stored == num_blocks) return num_blocks;
+
+	// doubly indirect part
+	uint16_t second[ADDRS_PER_BLOCK];
+	if(inp->i_addr[INDIR_ADDR] == 0) {
+		memset(second, 0, sizeof(second));
+	} else {
+		fsstats.indirectFetches++;
+		if(unixfilesystem_readsector(fs, inp->i_addr[INDIR_ADDR], second) < 0) return -1;
+	}
+	for(size_t i = 0; i < ADDRS_PER_BLOCK && stored < num_blocks; i++) {
+		int count = num_blocks - stored < (int) ADDRS_PER_BLOCK ? num_blocks - stored : (int) ADDRS_PER_BLOCK;
+		if(second[i] == 0) {
+			memset(blocks + stored, 0, count * sizeof(uint16_t));
+		} else {
+			fsstats.indirectFetches++;
+			if(unixfilesystem_readsector(fs, second[i], addrs) < 0) return -1;
+			memcpy(blocks + stored, addrs, count * sizeof(uint16_t));
+		}
+		stored += count;
+	}
+	return num_blocks;
+}
+
+
 /**
  * Computes the size in bytes of the file identified by the given inode
  */
 int inode_getsize(struct inode *inp) {
   return ((inp->i_size0 << 16) | inp->i_size1); 
 }
+
+
+/**
+ * Writes the given inode back to the filesystem as the specified inumber.
+ * Returns 0 on success, -1 on error.
+ */
+int inode_iput(struct unixfilesystem *fs, int inumber, struct inode *inp) {
+	inumber = inumber - 1;		// inumber starts from 1
+	int inode_num = DISKIMG_SECTOR_SIZE / sizeof(struct inode);
+	int sector = INODE_START_SECTOR + inumber / inode_num;
+
+	// read-modify-write the sector holding the inode
+	struct inode inodes[inode_num];
+	if(unixfilesystem_readsector(fs, sector, inodes) < 0) return -1;
+	inodes[inumber % inode_num] = *inp;
+	if(unixfilesystem_writesector(fs, sector, inodes) < 0) return -1;
+	return 0;
+}
+
+
+/**
+ * Stores size (which must fit in 24 bits) into the given inode.
+ */
+void inode_setsize(struct inode *inp, int size) {
+	inp->i_size0 = (size >> 16) & 0xff;
+	inp->i_size1 = size & 0xffff;
+}
+
+
+/**
+ * Returns the entry at index of the indirect block whose number is stored in
+ * *indirp, allocating the indirect block (updating *indirp) and the entry as
+ * needed.  Returns the block number on success, -1 on error.
+ */
+static int indirect_alloc(struct unixfilesystem *fs, uint16_t *indirp, int index) {
+	if(*indirp == 0) {
+		int indir = alloc_block(fs);
+		if(indir < 0) return -1;
+		*indirp = indir;
+	}
+
+	uint16_t addrs[ADDRS_PER_BLOCK];
+	if(unixfilesystem_readsector(fs, *indirp, addrs) < 0) return -1;
+	if(addrs[index] == 0) {
+		int block = alloc_block(fs);
+		if(block < 0) return -1;
+		addrs[index] = block;
+		if(unixfilesystem_writesector(fs, *indirp, addrs) < 0) return -1;
+	}
+	return addrs[index];
+}
+
+
+/**
+ * Like inode_indexlookup, but allocates the file block (and any indirect
+ * blocks needed to reach it) if it doesn't exist yet.
+ *
+ * Returns the disk block number on success, -1 on error.
+ */
+int inode_indexalloc(struct unixfilesystem *fs, struct inode *inp, int blockNum) {
+	if(blockNum < 0 || blockNum >= (int) MAX_FILE_BLOCKS) return -1;
+	int num_direct = sizeof(inp->i_addr) / sizeof(inp->i_addr[0]);
+
+	if((inp->i_mode & ILARG) == 0) {
+		// small file that stays small
+		if(blockNum < num_direct) {
+			if(inp->i_addr[blockNum] == 0) {
+				int block = alloc_block(fs);
+				if(block < 0) return -1;
+				inp->i_addr[blockNum] = block;
+			}
+			return inp->i_addr[blockNum];
+		}
+
+		// small file outgrowing i_addr: its direct blocks become the first indirect block
+		int indir = alloc_block(fs);
+		if(indir < 0) return -1;
+		uint16_t addrs[ADDRS_PER_BLOCK];
+		memset(addrs, 0, sizeof(addrs));
+		memcpy(addrs, inp->i_addr, sizeof(inp->i_addr));
+		if(unixfilesystem_writesector(fs, indir, addrs) < 0) return -1;
+		memset(inp->i_addr, 0, sizeof(inp->i_addr));
+		inp->i_addr[0] = indir;
+		inp->i_mode |= ILARG;
+	}
+
+	// large file, singly indirect part
+	int indir_addr_num = ADDRS_PER_BLOCK * INDIR_ADDR;
+	if(blockNum < indir_addr_num) {
+		return indirect_alloc(fs, &inp->i_addr[blockNum / ADDRS_PER_BLOCK], blockNum % ADDRS_PER_BLOCK);
+	}
+
+	// large file, doubly indirect part
+	int blockNum_in_double = blockNum - indir_addr_num;
+	int second = indirect_alloc(fs, &inp->i_addr[INDIR_ADDR], blockNum_in_double / ADDRS_PER_BLOCK);
+	if(second < 0) return -1;
+	uint16_t second_addr = second;	// freshly allocated blocks are zeroed, so this is already a valid indirect block
+	return indirect_alloc(fs, &second_addr, blockNum_in_double % ADDRS_PER_BLOCK);
+}
+
+
+/**
+ * Frees every file block numbered keepBlocks or higher that is reachable from
+ * the indirect block indir, whose first entry maps file block base.  If doubly
+ * is set, the entries of indir are themselves indirect blocks.  indir is freed
+ * too when none of it survives.  Returns 1 if indir was freed, 0 if it was kept
+ * and -1 on error.
+ */
+static int indirect_truncate(struct unixfilesystem *fs, int indir, int base, int keepBlocks, int doubly) {
+	int span = doubly ? ADDRS_PER_BLOCK : 1;	// file blocks covered by each entry
+	uint16_t addrs[ADDRS_PER_BLOCK];
+	if(unixfilesystem_readsector(fs, indir, addrs) < 0) return -1;
+
+	int changed = 0;
+	for(size_t i = 0; i < ADDRS_PER_BLOCK; i++) {
+		int entry_base = base + i * span;
+		if(addrs[i] == 0 || entry_base + span <= keepBlocks) continue;
+		if(doubly) {
+			int freed = indirect_truncate(fs, addrs[i], entry_base, keepBlocks, 0);
+			if(freed < 0) return -1;
+			if(!freed) continue;
+		} else if(alloc_freeblock(fs, addrs[i]) < 0) {
+			return -1;
+		}
+		addrs[i] = 0;
+		changed = 1;
+	}
+
+	if(base >= keepBlocks) {
+		return alloc_freeblock(fs, indir) < 0 ? -1 : 1;
+	}
+	if(changed && unixfilesystem_writesector(fs, indir, addrs) < 0) return -1;
+	return 0;
+}
+
+
+/**
+ * Releases every block of the file beyond the first size bytes and sets the size.
+ * Returns 0 on success, -1 on error.
+ */
+int inode_truncate(struct unixfilesystem *fs, struct inode *inp, int size) {
+	int keep_blocks = (size + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+	int num_direct = sizeof(inp->i_addr) / sizeof(inp->i_addr[0]);
+
+	if((inp->i_mode & ILARG) == 0) {
+		for(int i = keep_blocks; i < num_direct; i++) {
+			if(inp->i_addr[i] == 0) continue;
+			if(alloc_freeblock(fs, inp->i_addr[i]) < 0) return -1;
+			inp->i_addr[i] = 0;
+		}
+	} else {
+		for(int i = 0; i <= INDIR_ADDR; i++) {
+			if(inp->i_addr[i] == 0) continue;
+			int doubly = (i == INDIR_ADDR);
+			int freed = indirect_truncate(fs, inp->i_addr[i], i * ADDRS_PER_BLOCK, keep_blocks, doubly);
+			if(freed < 0) return -1;
+			if(freed) inp->i_addr[i] = 0;
+		}
+		if(size == 0) inp->i_mode &= ~ILARG;	// every address is gone
+	}
+
+	inode_setsize(inp, size);
+	return 0;
+}
@@ -17,9 +17,49 @@ int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp);
  */
 int inode_indexlookup(struct unixfilesystem *fs, struct inode *inp, int blockNum);
 
+/**
+ * Stores the disk block number of every block of the file in blocks, which
+ * must have room for one entry per block of the file's size (0 marks a
+ * hole).  Unlike calling inode_indexlookup once per block, each indirect
+ * block is read only once.
+ *
+ * Returns the number of blocks stored on success, -1 on error.
+ */
+int inode_getblocklist(struct unixfilesystem *fs, struct inode *inp, uint16_t *blocks);
+
 /**
  * Computes the size in bytes of the file identified by the given inode
  */
 int inode_getsize(struct inode *inp);
 
+/**
+ * Writes the given inode back to the filesystem as the specified inumber.
+ * Returns 0 on success, -1 on error.
+ */
+int inode_iput(struct unixfilesystem *fs, int inumber, struct inode *inp);
+
+/**
+ * Stores size (which must fit in 24 bits) into the given inode.
+ */
+void inode_setsize(struct inode *inp, int size);
+
+/**
+ * Like inode_indexlookup, but allocates the file block (and any indirect
+ * blocks needed to reach it) if it doesn't exist yet, converting a small
+ * file to the large addressing scheme once it outgrows i_addr.  The inode
+ * is updated in memory only; the caller writes it back with inode_iput.
+ *
+ * Returns the disk block number on success, -1 on error.
+ */
+int inode_indexalloc(struct unixfilesystem *fs, struct inode *inp, int blockNum);
+
+/**
+ * Releases every block of the file beyond the first size bytes, including
+ * indirect blocks that no longer map anything, and sets the size.  As with
+ * inode_indexalloc, the caller writes the inode back.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int inode_truncate(struct unixfilesystem *fs, struct inode *inp, int size);
+
 #endif // _INODE_
@@ -3,9 +3,14 @@
 #include "directory.h"
 #include "inode.h"
 #include "diskimg.h"
+#include "file.h"
+#include "alloc.h"
+#include "fsstats.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #define DIR_MAX_LEN 14
 
@@ -17,6 +22,7 @@ int helper(struct unixfilesystem *fs, int dirinumber, const char* path);
  * encountered.
  */
 int pathname_lookup(struct unixfilesystem *fs, const char *pathname) {
+	fsstats.pathLookups++;
 	int cmp = strcmp(pathname, "/");
 	if(cmp == 0) {
 		return ROOT_INUMBER;
@@ -31,6 +37,7 @@ int pathname_lookup(struct unixfilesystem *fs, const char *pathname) {
  * but in a recursive way, and without tackling root director
  */
 int helper(struct unixfilesystem *fs, int dirinumber, const char* path) {
+	fsstats.pathComponents++;
 	char* slash_start = strchr(path, '/');
 	if(slash_start == NULL) {		// no slash in the path
 		struct direntv6 entry;
@@ -40,7 +47,8 @@ int helper(struct unixfilesystem *fs, int dirinumber, const char* path) {
 	} else {						// the path has slash
 		char* newpath = slash_start + strlen("/");	// remove the forward slash
 		int dirlen = strlen(path) - strlen(newpath);
-		char dir[DIR_MAX_LEN];		// prepare for the first dir
+		char dir[DIR_MAX_LEN + 1];		// prepare for the first dir
+		if(dirlen - 1 > DIR_MAX_LEN) return -1;
 		strncpy(dir, path, dirlen);
 		dir[dirlen- 1] = '\0';		// set the terminal char for dir
 		struct direntv6 entry;
@@ -49,3 +57,269 @@ int helper(struct unixfilesystem *fs, int dirinumber, const char* path) {
 		return helper(fs, entry.d_inumber, newpath);
 	}
 }
+
+
+/**
+ * Orders pathnames component by component.  '/' sorts below every other
+ * character, so "/a/x" comes before "/a.b" and the pathnames that share a
+ * leading component are always adjacent.
+ */
+static int compare_paths(const char *a, const char *b) {
+	while(*a != '\0' && *a == *b) {
+		a++;
+		b++;
+	}
+	int ca = (*a == '/') ? 1 : (unsigned char) *a;
+	int cb = (*b == '/') ? 1 : (unsigned char) *b;
+	return ca - cb;
+}
+
+static const char **sort_paths;	// qsort has no context argument
+static int compare_indices(const void *a, const void *b) {
+	return compare_paths(sort_paths[*(const int *) a], sort_paths[*(const int *) b]);
+}
+
+struct path_group {
+	char name[DIR_MAX_LEN + 1];	// the component shared by the group
+	int start, end;				// the group is order[start, end)
+	int inumber;				// what name resolves to, or -1
+};
+
+static int compare_groups(const void *key, const void *group) {
+	return strcmp(key, ((const struct path_group *) group)->name);
+}
+
+/**
+ * Resolves the count pathnames order[0..count) relative to the directory
+ * dirinumber, where rest[k] is what is left of pathname order[k] below that
+ * directory.  The pathnames are grouped by their next component, the
+ * directory is scanned once to resolve every group, and each group whose
+ * pathnames go deeper is handed down to the directory it names.
+ * Returns the number of pathnames resolved, or -1 if out of memory.
+ */
+static int resolve_batch(struct unixfilesystem *fs, int dirinumber, const char **rest, int *order, int count, int *inumbers) {
+	struct path_group *groups = malloc(count * sizeof(struct path_group));
+	if(groups == NULL) return -1;
+
+	// sorting made the pathnames sharing a component adjacent
+	int num_groups = 0;
+	for(int k = 0; k < count; k++) {
+		int len = strcspn(rest[order[k]], "/");
+		if(len == 0 || len > DIR_MAX_LEN) continue;	// stays -1
+		if(num_groups > 0) {
+			struct path_group *last = &groups[num_groups - 1];
+			if((int) strlen(last->name) == len && strncmp(last->name, rest[order[k]], len) == 0) {
+				last->end = k + 1;
+				continue;
+			}
+		}
+		struct path_group *group = &groups[num_groups++];
+		memcpy(group->name, rest[order[k]], len);
+		group->name[len] = '\0';
+		group->start = k;
+		group->end = k + 1;
+		group->inumber = -1;
+	}
+
+	// one scan of the directory resolves every group
+	struct inode dir;
+	if(num_groups > 0 && inode_iget(fs, dirinumber, &dir) == 0 && (dir.i_mode & IFMT) == IFDIR) {
+		int total_block_num = (inode_getsize(&dir) + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+		for(int i = 0; i < total_block_num; i++) {
+			struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+			fsstats.dirBlocksScanned++;
+			int valid_bytes = file_getblock(fs, dirinumber, i, entries);
+			if(valid_bytes < 0) break;
+			int total_entry_num = valid_bytes / sizeof(struct direntv6);
+			for(int j = 0; j < total_entry_num; j++) {
+				if(entries[j].d_inumber == 0) continue;
+				char name[DIR_MAX_LEN + 1];
+				memcpy(name, entries[j].d_name, DIR_MAX_LEN);
+				name[DIR_MAX_LEN] = '\0';
+				struct path_group *group = bsearch(name, groups, num_groups, sizeof(struct path_group), compare_groups);
+				if(group != NULL && group->inumber < 0) group->inumber = entries[j].d_inumber;
+			}
+		}
+	}
+
+	int resolved = 0;
+	for(int g = 0; g < num_groups && resolved >= 0; g++) {
+		struct path_group *group = &groups[g];
+		if(group->inumber < 0) continue;
+		fsstats.pathComponents++;
+
+		// pathnames ending here sort ahead of those going deeper
+		int len = strlen(group->name);
+		int k = group->start;
+		for(; k < group->end && rest[order[k]][len] == '\0'; k++) {
+			inumbers[order[k]] = group->inumber;
+			resolved++;
+		}
+		if(k == group->end) continue;
+
+		for(int m = k; m < group->end; m++) rest[order[m]] += len + strlen("/");
+		int deeper = resolve_batch(fs, group->inumber, rest, order + k, group->end - k, inumbers);
+		resolved = deeper < 0 ? -1 : resolved + deeper;
+	}
+
+	free(groups);
+	return resolved;
+}
+
+/**
+ * Resolves numPaths absolute pathnames at once, scanning each directory on
+ * the way only once.  Returns the number of pathnames resolved, or a
+ * negative number if an error is encountered.
+ */
+int pathname_lookupbatch(struct unixfilesystem *fs, const char **pathnames, int numPaths, int *inumbers) {
+	int *order = malloc(numPaths * sizeof(int));
+	const char **rest = malloc(numPaths * sizeof(char *));
+	if(order == NULL || rest == NULL) {
+		free(order);
+		free(rest);
+		return -1;
+	}
+
+	int count = 0, resolved = 0;
+	for(int i = 0; i < numPaths; i++) {
+		fsstats.pathLookups++;
+		inumbers[i] = -1;
+		if(pathnames[i][0] != '/') continue;
+		if(strcmp(pathnames[i], "/") == 0) {
+			inumbers[i] = ROOT_INUMBER;
+			resolved++;
+			continue;
+		}
+		rest[i] = pathnames[i] + strlen("/");	// remove the forward slash
+		order[count++] = i;
+	}
+
+	sort_paths = pathnames;
+	qsort(order, count, sizeof(int), compare_indices);
+	int deeper = resolve_batch(fs, ROOT_INUMBER, rest, order, count, inumbers);
+
+	free(order);
+	free(rest);
+	return deeper < 0 ? -1 : resolved + deeper;
+}
+
+
+/**
+ * Splits pathname into its parent directory, whose inumber is returned, and
+ * its last component, which is copied into name (DIR_MAX_LEN + 1 bytes).
+ * Returns -1 if the parent can't be found or the last component is empty or
+ * too long.
+ */
+static int lookup_parent(struct unixfilesystem *fs, const char *pathname, char *name) {
+	const char* last_slash = strrchr(pathname, '/');
+	if(pathname[0] != '/' || last_slash == NULL) return -1;
+	const char* last = last_slash + strlen("/");
+	int name_len = strlen(last);
+	if(name_len == 0 || name_len > DIR_MAX_LEN) return -1;
+	strcpy(name, last);
+
+	if(last_slash == pathname) return ROOT_INUMBER;
+	int parent_len = last_slash - pathname;
+	char parent[parent_len + 1];
+	memcpy(parent, pathname, parent_len);
+	parent[parent_len] = '\0';
+	return pathname_lookup(fs, parent);
+}
+
+/**
+ * Frees every block of the given inode, clears it and returns it to the free
+ * inode list.  Returns 0 on success, -1 on error.
+ */
+static int release_inode(struct unixfilesystem *fs, int inumber, struct inode *inp) {
+	if(inode_truncate(fs, inp, 0) < 0) return -1;
+	memset(inp, 0, sizeof(*inp));
+	if(inode_iput(fs, inumber, inp) < 0) return -1;
+	return alloc_freeinode(fs, inumber);
+}
+
+/**
+ * Creates a new, empty file (or directory) at the specified pathname.
+ * Returns the new inumber, or a negative number if an error is encountered.
+ */
+int pathname_create(struct unixfilesystem *fs, const char *pathname, int mode) {
+	char name[DIR_MAX_LEN + 1];
+	int parent = lookup_parent(fs, pathname, name);
+	if(parent < 0) return -1;
+	struct direntv6 entry;
+	if(directory_findname(fs, name, parent, &entry) == 0) return -1;	// already exists
+
+	int inumber = alloc_inode(fs);
+	if(inumber < 0) return -1;
+	int is_dir = ((mode & IFMT) == IFDIR);
+	time_t now = time(NULL);
+	struct inode in;
+	memset(&in, 0, sizeof(in));
+	in.i_mode = IALLOC | (mode & ~(IALLOC | ILARG));
+	in.i_nlink = is_dir ? 2 : 1;	// a directory is also linked from its own "."
+	in.i_atime[0] = in.i_mtime[0] = now >> 16;
+	in.i_atime[1] = in.i_mtime[1] = now & 0xffff;
+	if(inode_iput(fs, inumber, &in) < 0) return -1;
+
+	if(is_dir) {
+		struct direntv6 dots[2];
+		memset(dots, 0, sizeof(dots));
+		dots[0].d_inumber = inumber;
+		strcpy(dots[0].d_name, ".");
+		dots[1].d_inumber = parent;
+		strcpy(dots[1].d_name, "..");
+		if(file_append(fs, inumber, dots, sizeof(dots)) < 0) {
+			if(inode_iget(fs, inumber, &in) == 0) release_inode(fs, inumber, &in);
+			return -1;
+		}
+	}
+
+	if(directory_addentry(fs, parent, name, inumber) < 0) {
+		if(inode_iget(fs, inumber, &in) == 0) release_inode(fs, inumber, &in);
+		return -1;
+	}
+
+	if(is_dir) {	// the parent gains a link from the new ".."
+		struct inode parent_in;
+		if(inode_iget(fs, parent, &parent_in) < 0) return -1;
+		parent_in.i_nlink++;
+		if(inode_iput(fs, parent, &parent_in) < 0) return -1;
+	}
+	return inumber;
+}
+
+/**
+ * Removes the entry at the specified pathname, freeing the inode once its
+ * last link is gone.  Returns 0 on success, or a negative number on error.
+ */
+int pathname_unlink(struct unixfilesystem *fs, const char *pathname) {
+	char name[DIR_MAX_LEN + 1];
+	int parent = lookup_parent(fs, pathname, name);
+	if(parent < 0) return -1;
+	if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return -1;
+
+	struct direntv6 entry;
+	if(directory_findname(fs, name, parent, &entry) < 0) return -1;
+	int inumber = entry.d_inumber;
+	struct inode in;
+	if(inode_iget(fs, inumber, &in) < 0) return -1;
+	int is_dir = ((in.i_mode & IFMT) == IFDIR);
+	if(is_dir && directory_isempty(fs, inumber) != 1) return -1;
+
+	if(directory_removeentry(fs, parent, name) < 0) return -1;
+
+	if(is_dir) {
+		// the directory's own "." and its parent's link through ".." go with it
+		in.i_nlink = 0;
+		struct inode parent_in;
+		if(inode_iget(fs, parent, &parent_in) < 0) return -1;
+		if(parent_in.i_nlink > 0) parent_in.i_nlink--;
+		if(inode_iput(fs, parent, &parent_in) < 0) return -1;
+	} else if(in.i_nlink > 0) {
+		in.i_nlink--;
+	}
+
+	if(in.i_nlink > 0) return inode_iput(fs, inumber, &in);
+
+	// last link gone: release the blocks, then the inode
+	return release_inode(fs, inumber, &in);
+}
@@ -10,4 +10,32 @@
  */
 int pathname_lookup(struct unixfilesystem *fs, const char *pathname);
 
+/**
+ * Resolves numPaths absolute pathnames at once, storing the inumber of
+ * pathnames[i] in inumbers[i] (or -1 if it can't be resolved).  Rather than
+ * walking from the root once per pathname, the pathnames are sorted so that
+ * those sharing a prefix are adjacent, and each directory on the way is
+ * scanned only once, resolving every child the batch needs from it in that
+ * one scan.  Returns the number of pathnames resolved, or a negative number
+ * if an error (other than a pathname not resolving) is encountered.
+ */
+int pathname_lookupbatch(struct unixfilesystem *fs, const char **pathnames, int numPaths, int *inumbers);
+
+/**
+ * Creates a new, empty file at the specified absolute pathname with the given
+ * mode (type and permission bits; IALLOC is added).  If the mode says IFDIR,
+ * the new directory gets its "." and ".." entries.  The parent directory must
+ * already exist and must not hold an entry with the same name.  Returns the
+ * new inumber, or a negative number if an error is encountered.
+ */
+int pathname_create(struct unixfilesystem *fs, const char *pathname, int mode);
+
+/**
+ * Removes the entry at the specified absolute pathname.  The inode loses a
+ * link and, once it has none left, its blocks and the inode itself are
+ * freed.  Directories must be empty.  Returns 0 on success, or a negative
+ * number if an error is encountered.
+ */
+int pathname_unlink(struct unixfilesystem *fs, const char *pathname);
+
 #endif // _PATHNAME_H_
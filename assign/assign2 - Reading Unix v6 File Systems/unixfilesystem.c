@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "unixfilesystem.h"
 #include "diskimg.h" 
+#include "bufcache.h"
 
 /**
  * Allocates and initializes a struct unixfilesystem given a filedescriptor to 
@@ -35,11 +36,48 @@ struct unixfilesystem *unixfilesystem_init(int dfd) {
   }
 
   fs->dfd = dfd;  
+  fs->bcache = NULL;
   if (diskimg_readsector(dfd, SUPERBLOCK_SECTOR, &fs->superblock) != DISKIMG_SECTOR_SIZE) {
     fprintf(stderr, "Error reading superblock\n");
     free(fs);
     return NULL;
   }
+  fs->superblock.s_fmod = 0; // from here on, set only when we modify the superblock
 
   return fs;
 }
+
+int unixfilesystem_attachcache(struct unixfilesystem *fs, int numBuffers) {
+  if (fs->bcache != NULL) return -1;
+  fs->bcache = bufcache_create(fs->dfd, numBuffers);
+  return fs->bcache == NULL ? -1 : 0;
+}
+
+int unixfilesystem_readsector(struct unixfilesystem *fs, int sectorNum, void *buf) {
+  if (fs->bcache != NULL) return bufcache_read(fs->bcache, sectorNum, buf);
+  return diskimg_readsector(fs->dfd, sectorNum, buf);
+}
+
+int unixfilesystem_writesector(struct unixfilesystem *fs, int sectorNum, void *buf) {
+  if (fs->bcache != NULL) return bufcache_write(fs->bcache, sectorNum, buf);
+  return diskimg_writesector(fs->dfd, sectorNum, buf);
+}
+
+int unixfilesystem_sync(struct unixfilesystem *fs) {
+  if (fs->superblock.s_fmod) {
+    fs->superblock.s_fmod = 0;
+    if (unixfilesystem_writesector(fs, SUPERBLOCK_SECTOR, &fs->superblock) != DISKIMG_SECTOR_SIZE) {
+      fs->superblock.s_fmod = 1;
+      return -1;
+    }
+  }
+
+  if (fs->bcache != NULL) return bufcache_sync(fs->bcache);
+  return 0;
+}
+
+void unixfilesystem_free(struct unixfilesystem *fs) {
+  if (fs == NULL) return;
+  bufcache_free(fs->bcache);
+  free(fs);
+}
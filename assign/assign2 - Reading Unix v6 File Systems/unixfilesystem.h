@@ -25,11 +25,40 @@
 #define ROOT_INUMBER        1
 #define BOOTBLOCK_MAGIC_NUM 0407
 
+struct bufcache;
+
 struct unixfilesystem {
   int dfd; // Handle from the diskimg module to read the diskimg.
   struct filsys superblock;  // The superblock read from the diskimage.
+  struct bufcache *bcache;   // Write-back cache in front of dfd, or NULL.
 };
 
 struct unixfilesystem *unixfilesystem_init(int fd);
 
+/**
+ * Puts a write-back buffer cache of numBuffers sectors in front of the disk
+ * image.  Until then every sector read and write goes straight to the disk.
+ * Returns 0 on success, -1 on error.
+ */
+int unixfilesystem_attachcache(struct unixfilesystem *fs, int numBuffers);
+
+/**
+ * Reads or writes a sector of the filesystem, going through the buffer cache
+ * if one is attached.  Both return the number of bytes moved, or -1 on error.
+ */
+int unixfilesystem_readsector(struct unixfilesystem *fs, int sectorNum, void *buf);
+int unixfilesystem_writesector(struct unixfilesystem *fs, int sectorNum, void *buf);
+
+/**
+ * Writes the superblock back if it was modified (s_fmod) and flushes every
+ * dirty sector held by the buffer cache.  Returns 0 on success, -1 on error.
+ */
+int unixfilesystem_sync(struct unixfilesystem *fs);
+
+/**
+ * Releases fs and its buffer cache.  Unsynced modifications are lost.
+ * As with free, passing NULL (from a failed unixfilesystem_init) is fine.
+ */
+void unixfilesystem_free(struct unixfilesystem *fs);
+
 #endif // _UNIXFILESYSTEM_H_
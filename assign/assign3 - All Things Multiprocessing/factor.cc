@@ -0,0 +1,184 @@
+/**
+ * File: factor.cc
+ * ---------------
+ * A compiled stand-in for factor.py that speaks exactly the same protocol:
+ * numbers arrive one per line on stdin, and each is answered with a line like
+ *
+ *    12345 = 3 * 5 * 823 [pid: 4312, time: 1.2e-05 seconds]
+ *
+ * on stdout.  Given --self-halting, it stops itself before reading each number,
+ * just as factor.py does, so farm can drive it with either of its protocols.
+ *
+ * Rather than trial division all the way up to the number, small factors are
+ * divided out directly, what remains is tested with a Miller-Rabin test that
+ * is deterministic for 64-bit inputs, and composites are split with Pollard's
+ * rho (Brent's variant).
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+using namespace std;
+
+typedef unsigned long long u64;
+__extension__ typedef unsigned __int128 u128;
+
+static u64 mulmod(u64 a, u64 b, u64 m) {
+  return (u128) a * b % m;
+}
+
+static u64 powmod(u64 base, u64 exp, u64 m) {
+  u64 result = 1;
+  base %= m;
+  while (exp > 0) {
+    if (exp & 1) result = mulmod(result, base, m);
+    base = mulmod(base, base, m);
+    exp >>= 1;
+  }
+  return result;
+}
+
+/**
+ * Function: isPrime
+ * -----------------
+ * Miller-Rabin with the first twelve primes as witnesses, which is known
+ * to be exact for every n below 2^64.
+ */
+static bool isPrime(u64 n) {
+  static const u64 kWitnesses[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+  if (n < 2) return false;
+  for (u64 p: kWitnesses) {
+    if (n % p == 0) return n == p;
+  }
+
+  u64 d = n - 1;
+  int s = 0;
+  while ((d & 1) == 0) {
+    d >>= 1;
+    s++;
+  }
+  for (u64 a: kWitnesses) {
+    u64 x = powmod(a, d, n);
+    if (x == 1 || x == n - 1) continue;
+    bool composite = true;
+    for (int r = 1; r < s && composite; r++) {
+      x = mulmod(x, x, n);
+      if (x == n - 1) composite = false;
+    }
+    if (composite) return false;
+  }
+  return true;
+}
+
+static u64 gcd(u64 a, u64 b) {
+  while (b != 0) {
+    u64 t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/**
+ * Function: findDivisor
+ * ---------------------
+ * Pollard's rho with Brent's cycle detection, batching the gcd over runs of
+ * products.  n must be an odd composite; returns a nontrivial divisor.
+ */
+static u64 findDivisor(u64 n) {
+  static const u64 kBatch = 128;
+  for (u64 c = 1; ; c++) {
+    u64 y = 2, x = 2, ys = 2, q = 1, g = 1;
+    for (u64 r = 1; g == 1; r <<= 1) {
+      x = y;
+      for (u64 i = 0; i < r; i++) y = (mulmod(y, y, n) + c) % n;
+      for (u64 k = 0; k < r && g == 1; k += kBatch) {
+        ys = y;
+        for (u64 i = 0; i < min(kBatch, r - k); i++) {
+          y = (mulmod(y, y, n) + c) % n;
+          q = mulmod(q, x > y ? x - y : y - x, n);
+        }
+        g = gcd(q, n);
+      }
+    }
+    if (g == n) { // the batch overshot; step back through it one term at a time
+      do {
+        ys = (mulmod(ys, ys, n) + c) % n;
+        g = gcd(x > ys ? x - ys : ys - x, n);
+      } while (g == 1);
+    }
+    if (g != n) return g;
+  }
+}
+
+static void factorInto(u64 n, vector<u64>& factors) {
+  if (n == 1) return;
+  if (isPrime(n)) {
+    factors.push_back(n);
+    return;
+  }
+  u64 d = findDivisor(n);
+  factorInto(d, factors);
+  factorInto(n / d, factors);
+}
+
+/**
+ * Function: factorization
+ * -----------------------
+ * Mirrors factorization in factor.py, including its answers for 1 and for
+ * numbers below 1 (which have no factors listed).
+ */
+static string factorization(long long num) {
+  string response = to_string(num) + " = ";
+  if (num == 1) return response + "1";
+  if (num < 1) return response;
+
+  vector<u64> factors;
+  u64 n = num;
+  static const u64 kSmallPrimes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47};
+  for (u64 p: kSmallPrimes) {
+    while (n % p == 0) {
+      factors.push_back(p);
+      n /= p;
+    }
+  }
+  factorInto(n, factors);
+  sort(factors.begin(), factors.end());
+
+  for (size_t i = 0; i < factors.size(); i++) {
+    if (i > 0) response += " * ";
+    response += to_string(factors[i]);
+  }
+  return response;
+}
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  // like factor.py, die along with the farm that spawned us
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  bool selfHalting = argc > 1 && strcmp(argv[1], "--self-halting") == 0;
+  pid_t pid = getpid();
+  while (true) {
+    if (selfHalting) kill(pid, SIGSTOP);
+    long long num;
+    if (scanf("%lld", &num) != 1) break;
+    double start = now();
+    string response = factorization(num);
+    double stop = now();
+    printf("%s [pid: %d, time: %g seconds]\n", response.c_str(), pid, stop - start);
+    fflush(stdout);
+  }
+  return 0;
+}
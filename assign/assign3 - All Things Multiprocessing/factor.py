@@ -36,4 +36,5 @@ while True:
     response = factorization(num)
     stop = time.time()
     print '%s [pid: %d, time: %g seconds]' % (response, pid, stop - start)
+    sys.stdout.flush() # farm --stream reads answers over a pipe as they come
     
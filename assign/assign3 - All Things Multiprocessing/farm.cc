@@ -5,6 +5,11 @@
 #include <iostream>
 #include <cstdlib>
 #include <vector>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <sched.h>
@@ -12,15 +17,24 @@
 
 using namespace std;
 
+struct task {
+	size_t pos;		// input position
+	long long num;
+};
+
 struct worker {
-	worker() {}
-	worker(char *argv[]) : sp(subprocess(argv, true, false)), available(false) {}
+	worker() : available(false), dead(false) {}
+	worker(char *argv[], bool ingest) : sp(subprocess(argv, true, ingest)), available(false), dead(false) {}
 	subprocess_t sp;
 	bool available;
+	bool dead;				// stream mode: its output reached EOF, so it's handed nothing more
+	deque<task> inflight;	// stream mode: the numbers sent but not yet answered, oldest first
+	string partial;			// stream mode: output read past the last complete line
 };
 
 static const size_t kNumCPUs = sysconf(_SC_NPROCESSORS_ONLN);
-static vector<worker> workers(kNumCPUs);
+static size_t numWorkers = kNumCPUs;	// one per CPU unless --workers says otherwise
+static vector<worker> workers;
 static size_t numWorkersAvailable = 0;
 
 static void markWorkersAsAvailable(int sig) {
@@ -30,7 +44,7 @@ static void markWorkersAsAvailable(int sig) {
 			break;
 		}
 		// reap a halted worker, mark him available
-		for(size_t w = 0; w < kNumCPUs; w++) {
+		for(size_t w = 0; w < numWorkers; w++) {
 			if(workers[w].sp.pid == pid) {
 				workers[w].available = true;
 				numWorkersAvailable++;
@@ -40,17 +54,70 @@ static void markWorkersAsAvailable(int sig) {
 	}
 }
 
+/**
+ * Stream mode replaces the SIGSTOP/SIGCONT handshake: workers keep running and
+ * read numbers from supplyfd as fast as they can, and farm reads each answer
+ * back over ingestfd.  Each worker may have at most kCreditsPerWorker numbers
+ * outstanding, and every answer returns a credit, so the pipes never fill up
+ * and the fastest workers are handed the most numbers.
+ */
+static bool streamMode = false;
+static bool reportTiming = false;
+static size_t kCreditsPerWorker = 2;
+static size_t numTasks = 0;
+static int epollfd = -1;	// watches every live worker's ingestfd
+static size_t numLiveWorkers = 0;
+static deque<task> orphans;	// numbers whose worker died before answering them
+
+/**
+ * Ordered mode (a refinement of stream mode) publishes answers in the order
+ * their numbers were read rather than the order workers finish them.  A
+ * worker answers its numbers first in, first out, so each answer is matched
+ * to its input position through the worker's inflight queue and parked in a
+ * ring of kReorderWindow slots until everything before it has been
+ * published.  At most kReorderWindow numbers are ever unpublished, which
+ * bounds the buffer no matter how far one slow number holds the rest up.
+ */
+static bool orderedOutput = false;
+static size_t kReorderWindow = 256;
+static size_t numRead = 0;			// input position of the next number read
+static size_t numPublished = 0;		// input position of the next answer to publish
+static vector<string> reorderBuffer;
+static vector<bool> reorderReady;
+
+// --native swaps the Python interpreter for the compiled ./factor, which speaks the same protocol
+static bool nativeWorkers = false;
 static const char *kWorkerArguments[] = {"./factor.py", "--self-halting", NULL};
+static const char *kStreamWorkerArguments[] = {"./factor.py", NULL};
+static const char *kNativeWorkerArguments[] = {"./factor", "--self-halting", NULL};
+static const char *kNativeStreamWorkerArguments[] = {"./factor", NULL};
 static void spawnAllWorkers() {
 	cout << "There are this many CPUs: " << kNumCPUs << ", numbered 0 through " << kNumCPUs - 1 << "." << endl;
-	for (size_t i = 0; i < kNumCPUs; i++) {
+	// a worker can halt itself before its pid is recorded, and the handler
+	// would then lose that stop, so hold SIGCHLD until every pid is known
+	sigset_t additions;
+	sigemptyset(&additions);
+	sigaddset(&additions, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &additions, NULL);
+	workers.resize(numWorkers);
+	for (size_t i = 0; i < numWorkers; i++) {
 		cpu_set_t set;
 		CPU_ZERO(&set);
-		CPU_SET(i, &set);
-		workers[i] = worker((char**)kWorkerArguments);
+		CPU_SET(i % kNumCPUs, &set);
+		const char **args = streamMode ? (nativeWorkers ? kNativeStreamWorkerArguments : kStreamWorkerArguments)
+		                               : (nativeWorkers ? kNativeWorkerArguments : kWorkerArguments);
+		workers[i] = worker((char**)args, streamMode);
+		if(streamMode) {
+			numLiveWorkers++;
+			struct epoll_event info;
+			info.events = EPOLLIN;
+			info.data.u64 = i;
+			epoll_ctl(epollfd, EPOLL_CTL_ADD, workers[i].sp.ingestfd, &info);
+		}
 		sched_setaffinity(workers[i].sp.pid, sizeof(cpu_set_t), &set);
-		cout << "Worker " << workers[i].sp.pid << " is set to run on CPU " << i << "." << endl;
+		cout << "Worker " << workers[i].sp.pid << " is set to run on CPU " << i % kNumCPUs << "." << endl;
 	}
+	sigprocmask(SIG_UNBLOCK, &additions, NULL);
 }
 
 static size_t getAvailableWorker() {
@@ -63,8 +130,8 @@ static size_t getAvailableWorker() {
 	while(numWorkersAvailable == 0) {
 		sigsuspend(&existingmask);
 	}
-	int idx = kNumCPUs;
-	for(size_t w = 0; w < kNumCPUs; w++) {
+	int idx = numWorkers;
+	for(size_t w = 0; w < numWorkers; w++) {
 		if(workers[w].available) {
 			idx = w;
 			break;
@@ -85,12 +152,13 @@ static void broadcastNumbersToWorkers() {
 		if (endpos != line.size()) break;
 		// get available worker index
 		size_t idx = getAvailableWorker();
-		if(idx < kNumCPUs) {
+		if(idx < numWorkers) {
 			workers[idx].available = false;
 			numWorkersAvailable--;
 			// feed num to supplyfd and tell him to continue
 			dprintf(workers[idx].sp.supplyfd, "%lld\n", num);
 			kill(workers[idx].sp.pid, SIGCONT);
+			numTasks++;
 		}
 	}
 }
@@ -102,7 +170,7 @@ static void waitForAllWorkers() {
 	sigaddset(&additions, SIGCHLD);
 	sigprocmask(SIG_BLOCK, &additions, &existingmask);
 	// check all workers finish their work
-	while(numWorkersAvailable != kNumCPUs) {
+	while(numWorkersAvailable != numWorkers) {
 		sigsuspend(&existingmask);
 	}
 	// unblock SIGCHLD
@@ -111,14 +179,14 @@ static void waitForAllWorkers() {
 
 static void closeAllWorkers() {
 	signal(SIGCHLD, SIG_DFL);
-	for(size_t w = 0; w < kNumCPUs; w++) {
+	for(size_t w = 0; w < numWorkers; w++) {
 		// close supplyfds to indicate an EOF
 		close(workers[w].sp.supplyfd);
 		// py ends when detecting an EOF, but should restart first
 		kill(workers[w].sp.pid, SIGCONT);
 	}
 	// check all workers come back
-	for(size_t i = 0; i < kNumCPUs; i++) {
+	for(size_t i = 0; i < numWorkers; i++) {
 		while(true) {
 			int status;
 			waitpid(workers[i].sp.pid, &status, 0);
@@ -129,11 +197,234 @@ static void closeAllWorkers() {
 	}
 }
 
+/**
+ * Publishes the answer for the number at input position pos, immediately
+ * unless output is ordered, in which case it waits in the reorder buffer
+ * until every earlier answer has gone out.
+ */
+static void publishResult(size_t pos, const string& line) {
+	numTasks++;
+	if(!orderedOutput) {
+		cout << line << flush;
+		return;
+	}
+
+	reorderBuffer[pos % kReorderWindow] = line;
+	reorderReady[pos % kReorderWindow] = true;
+	bool published = false;
+	while(reorderReady[numPublished % kReorderWindow]) {
+		size_t slot = numPublished % kReorderWindow;
+		cout << reorderBuffer[slot];
+		reorderBuffer[slot].clear();
+		reorderReady[slot] = false;
+		numPublished++;
+		published = true;
+	}
+	if(published) cout << flush;
+}
+
+/**
+ * Reads whatever the given worker has written, publishing every complete line
+ * and returning a credit for each.  Returns false once the worker's output
+ * reaches EOF.
+ */
+static bool ingestWorkerOutput(worker& w) {
+	char buf[4096];
+	ssize_t n = read(w.sp.ingestfd, buf, sizeof(buf));
+	if(n <= 0) return false;
+	w.partial.append(buf, n);
+	size_t start = 0, newline;
+	while((newline = w.partial.find('\n', start)) != string::npos) {
+		if(!w.inflight.empty()) {
+			publishResult(w.inflight.front().pos, w.partial.substr(start, newline - start + 1));
+			w.inflight.pop_front();
+		}
+		start = newline + 1;
+	}
+	w.partial.erase(0, start);
+	return true;
+}
+
+static bool anyResultsOutstanding() {
+	for(size_t w = 0; w < numWorkers; w++) {
+		if(!workers[w].inflight.empty()) return true;
+	}
+	return false;
+}
+
+/**
+ * Retires a worker whose output reached EOF.  It can't answer what it still
+ * holds, so those numbers become orphans, to be handed to the workers that
+ * remain.  If none remain, farm reports what went unanswered and gives up.
+ */
+static void retireWorker(worker& w) {
+	epoll_ctl(epollfd, EPOLL_CTL_DEL, w.sp.ingestfd, NULL);
+	w.dead = true;
+	numLiveWorkers--;
+	if(w.inflight.empty()) return;
+
+	cerr << "Worker " << w.sp.pid << " died with " << w.inflight.size() << " number"
+		 << (w.inflight.size() == 1 ? "" : "s") << " unanswered." << endl;
+	orphans.insert(orphans.end(), w.inflight.begin(), w.inflight.end());
+	w.inflight.clear();
+	if(numLiveWorkers > 0) return;
+
+	cerr << "No workers are left to factor:";
+	for(const task& t: orphans) cerr << " " << t.num;
+	cerr << endl;
+	exit(1);
+}
+
+/**
+ * Blocks until at least one worker has answered (or died), then ingests the
+ * answers of every worker epoll reports as readable.
+ */
+static void awaitResults() {
+	if(!anyResultsOutstanding()) return;
+	vector<struct epoll_event> events(numWorkers);
+	int numEvents = epoll_wait(epollfd, events.data(), events.size(), -1);
+	for(int i = 0; i < numEvents; i++) {
+		worker& w = workers[events[i].data.u64];
+		if(!ingestWorkerOutput(w)) retireWorker(w);
+	}
+}
+
+static void dispatchOrphans();
+
+/**
+ * Returns the live worker with credit to spare and the fewest numbers
+ * outstanding, waiting for answers to come back if every worker is out of
+ * credit or, unless the number is an orphan (whose slot in the reorder buffer
+ * is already held), the reorder buffer is full.
+ */
+static size_t getWorkerWithCredit(bool orphan) {
+	while(true) {
+		if(numLiveWorkers == 0) {
+			cerr << "No workers are left to factor." << endl;
+			exit(1);
+		}
+		size_t best = numWorkers;
+		for(size_t w = 0; w < numWorkers; w++) {
+			if(workers[w].dead || workers[w].inflight.size() >= kCreditsPerWorker) continue;
+			if(best == numWorkers || workers[w].inflight.size() < workers[best].inflight.size()) best = w;
+		}
+		bool windowFull = !orphan && orderedOutput && numRead - numPublished >= kReorderWindow;
+		if(best < numWorkers && !windowFull) return best;
+		// orphans may be all that's holding the window up
+		if(!orphan) dispatchOrphans();
+		awaitResults();
+	}
+}
+
+static void sendTask(const task& t, bool orphan) {
+	size_t idx = getWorkerWithCredit(orphan);
+	workers[idx].inflight.push_back(t);
+	// a worker that's died without our noticing yet fails this with EPIPE;
+	// its EOF turns the number back into an orphan
+	dprintf(workers[idx].sp.supplyfd, "%lld\n", t.num);
+}
+
+static void dispatchOrphans() {
+	while(!orphans.empty()) {
+		task t = orphans.front();
+		orphans.pop_front();
+		sendTask(t, true);
+	}
+}
+
+static void streamNumbersToWorkers() {
+	while (true) {
+		string line;
+		getline(cin, line);
+		if (cin.fail()) break;
+		size_t endpos;
+		long long num = stoll(line, &endpos);
+		if (endpos != line.size()) break;
+		dispatchOrphans();
+		sendTask({numRead++, num}, false);
+	}
+}
+
+static void closeAllStreamWorkers() {
+	// every number has to be answered before the workers are told to exit,
+	// since one that dies in the meantime leaves orphans for the others
+	dispatchOrphans();
+	while(anyResultsOutstanding()) {
+		awaitResults();
+		dispatchOrphans();
+	}
+	// EOF on supplyfd tells each worker to exit
+	for(size_t w = 0; w < numWorkers; w++) {
+		close(workers[w].sp.supplyfd);
+	}
+	for(size_t w = 0; w < numWorkers; w++) {
+		close(workers[w].sp.ingestfd);
+		waitpid(workers[w].sp.pid, NULL, 0);
+	}
+	close(epollfd);
+}
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void usage(const char *progname) {
+	cerr << "Usage: " << progname << " [--stream] [--ordered] [--window=<n>] [--credits=<n>] [--native] [--workers=<n>] [--timing]" << endl;
+	exit(1);
+}
+
 int main(int argc, char *argv[]) {
-	signal(SIGCHLD, markWorkersAsAvailable);
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--stream") == 0) streamMode = true;
+		else if(strcmp(argv[i], "--ordered") == 0) streamMode = orderedOutput = true;
+		else if(strncmp(argv[i], "--window=", strlen("--window=")) == 0) {
+			int window = atoi(argv[i] + strlen("--window="));
+			if(window < 1) usage(argv[0]);
+			kReorderWindow = window;
+		}
+		else if(strcmp(argv[i], "--timing") == 0) reportTiming = true;
+		else if(strcmp(argv[i], "--native") == 0) nativeWorkers = true;
+		else if(strncmp(argv[i], "--workers=", strlen("--workers=")) == 0) {
+			int count = atoi(argv[i] + strlen("--workers="));
+			if(count < 1) usage(argv[0]);
+			numWorkers = count;
+		}
+		else if(strncmp(argv[i], "--credits=", strlen("--credits=")) == 0) {
+			int credits = atoi(argv[i] + strlen("--credits="));
+			if(credits < 1) usage(argv[0]);
+			kCreditsPerWorker = credits;
+		}
+		else usage(argv[0]);
+	}
+
+	if(!streamMode) signal(SIGCHLD, markWorkersAsAvailable);
+	if(streamMode) epollfd = epoll_create1(0);
+	if(orderedOutput) {
+		reorderBuffer.resize(kReorderWindow);
+		reorderReady.resize(kReorderWindow, false);
+	}
 	spawnAllWorkers();
-	broadcastNumbersToWorkers();
-	waitForAllWorkers();
-	closeAllWorkers();
+	// a write to a worker that's died should fail, not kill farm; set only
+	// now, since the workers would otherwise inherit it through exec
+	if(streamMode) signal(SIGPIPE, SIG_IGN);
+	double start = now();
+	if(streamMode) {
+		streamNumbersToWorkers();
+		closeAllStreamWorkers();
+	} else {
+		broadcastNumbersToWorkers();
+		waitForAllWorkers();
+		closeAllWorkers();
+	}
+	double elapsed = now() - start;
+
+	// the stop/continue protocol never sees answers, so count what was handed out
+	if(reportTiming) {
+		cerr << (orderedOutput ? "ordered stream" : streamMode ? "stream" : "stop/continue") << " mode, "
+			 << numWorkers << (nativeWorkers ? " native" : " python") << " workers: " << numTasks << " tasks in "
+			 << elapsed << " seconds (" << (elapsed > 0 ? numTasks / elapsed : 0) << " tasks/second)" << endl;
+	}
 	return 0;
 }
@@ -33,10 +33,21 @@ static void summarizePipeline(char *argv1[], char *argv2[]) {
   printf("\n");
 }
 
+static void reportGroup(pid_t pgid, pid_t pids[], size_t numPids) {
+  bool shared = pgid != -1;
+  for (size_t i = 0; i < numPids && shared; i++) {
+    shared = getpgid(pids[i]) == pgid; // unreaped, so even finished ones still report it
+  }
+  printf("All %zu processes in process group %d: %s\n", numPids, pgid, shared ? "yes" : "no");
+  fflush(stdout);
+}
+
 static void launchPipedExecutables(char *argv1[], char *argv2[]) {
   summarizePipeline(argv1, argv2);
+  fflush(stdout);
   pid_t pids[2];
   pipeline(argv1, argv2, pids);
+  reportGroup(getpgrp(), pids, 2); // pipeline leaves them in ours
   waitpid(pids[0], NULL, 0);
   waitpid(pids[1], NULL, 0);
 }
@@ -47,7 +58,39 @@ static void simpleTest() {
   launchPipedExecutables(argv1, argv2);
 }
 
+static void multiStageTest() {
+  char *argv1[] = {"cat", "/usr/include/tar.h", NULL};
+  char *argv2[] = {"tr", "a-z", "A-Z", NULL};
+  char *argv3[] = {"grep", "DEFINE", NULL};
+  char *argv4[] = {"wc", "-l", NULL};
+  char **argvs[] = {argv1, argv2, argv3, argv4};
+  printf("Pipeline: cat /usr/include/tar.h -> tr a-z A-Z -> grep DEFINE -> wc -l\n");
+  fflush(stdout);
+  pid_t pids[4];
+  pid_t pgid = pipelinev(argvs, 4, pids, true);
+  reportGroup(pgid, pids, 4);
+  if (pgid == getpgrp()) printf("The new process group is this process's own\n");
+  for (size_t i = 0; i < 4; i++) waitpid(pids[i], NULL, 0);
+}
+
+static void fanoutTest() {
+  char *producer[] = {"seq", "1", "500000", NULL};
+  char *consumer1[] = {"wc", "-l", NULL};
+  char *consumer2[] = {"head", "-2", NULL}; // exits early; the relay has to carry on without it
+  char *consumer3[] = {"md5sum", NULL};
+  char *consumer4[] = {"tail", "-1", NULL};
+  char **consumers[] = {consumer1, consumer2, consumer3, consumer4};
+  printf("Fanout: seq 1 500000 -> {wc -l, head -2, md5sum, tail -1}\n");
+  fflush(stdout);
+  pid_t pids[6];
+  pid_t pgid = pipeline_fanout(producer, consumers, 4, pids);
+  reportGroup(pgid, pids, 6);
+  for (size_t i = 0; i < 6; i++) waitpid(pids[i], NULL, 0);
+}
+
 int main(int argc, char *argv[]) {
   simpleTest();
+  multiStageTest();
+  fanoutTest();
   return 0;
 }
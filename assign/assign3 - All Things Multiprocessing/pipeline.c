@@ -1,33 +1,273 @@
 /**
  * File: pipeline.c
  * ----------------
- * Presents the implementation of the pipeline routine.
+ * Presents the implementation of the pipeline routines.
  */
 
+#define _GNU_SOURCE // pipe2, F_SETPIPE_SZ, tee, splice
 #include "pipeline.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+static const int kInherit = -1;
+static const pid_t kCallersGroup = -1;
+
+/**
+ * Function: makePipe
+ * ------------------
+ * Every pipe is close-on-exec, so an exec'ed stage keeps only the
+ * two ends it dup2'ed onto its stdin and stdout, and the parent
+ * needn't close the others in each child.
+ */
+static int makePipe(int fds[2]) {
+	if(pipe2(fds, O_CLOEXEC) == -1) return -1;
+	fcntl(fds[1], F_SETPIPE_SZ, kPipelineBufferSize); // best-effort; see pipeline.h
+	return 0;
+}
+
+static void closeAll(int fds[], size_t numFds) {
+	for(size_t i = 0; i < numFds; i++) close(fds[i]);
+}
+
+/**
+ * Function: rewire
+ * ----------------
+ * Installs fd as target, clearing close-on-exec either way (dup2 does
+ * that for the copy, but is a no-op if fd already is target).
+ */
+static void rewire(int fd, int target) {
+	if(fd == kInherit) return;
+	if(fd == target) {
+		fcntl(fd, F_SETFD, 0);
+	} else {
+		dup2(fd, target);
+	}
+}
+
+/**
+ * Function: joinGroup
+ * -------------------
+ * Called by both parent and child after each fork, so the child is in the
+ * group before either of them moves on.  A pgid of 0 starts a new group
+ * led by pid, and kCallersGroup leaves pid in the group it was forked into.
+ */
+static void joinGroup(pid_t pid, pid_t pgid) {
+	if(pgid == kCallersGroup) return;
+	setpgid(pid, pgid == 0 ? pid : pgid);
+}
+
+static pid_t spawnStage(char *argv[], int in, int out, pid_t pgid) {
+	pid_t pid = fork();
+	if(pid == 0) {
+		joinGroup(0, pgid);
+		rewire(in, STDIN_FILENO);
+		rewire(out, STDOUT_FILENO);
+		execvp(argv[0], argv);
+		fprintf(stderr, "%s: command not found\n", argv[0]);
+		_exit(127);
+	}
+	if(pid > 0) joinGroup(pid, pgid);
+	return pid;
+}
+
+/**
+ * Function: abandon
+ * -----------------
+ * Undoes a partially launched pipeline: kills and reaps every stage
+ * launched so far and closes every pipe.
+ */
+static pid_t abandon(pid_t pids[], size_t numLaunched, int fds[], size_t numFds) {
+	for(size_t i = 0; i < numLaunched; i++) kill(pids[i], SIGKILL); // not the group, which may be the caller's
+	for(size_t i = 0; i < numLaunched; i++) waitpid(pids[i], NULL, 0);
+	closeAll(fds, numFds);
+	return -1;
+}
+
+pid_t pipelinev(char **argvs[], size_t numStages, pid_t pids[], bool newGroup) {
+	if(numStages == 0) return -1;
+	size_t numFds = 2 * (numStages - 1);
+	int fds[numFds + 1];
+	for(size_t i = 0; i + 1 < numStages; i++) {
+		if(makePipe(fds + 2 * i) == -1) return abandon(pids, 0, fds, 2 * i);
+	}
+
+	for(size_t i = 0; i < numStages; i++) {
+		int in = i == 0 ? kInherit : fds[2 * (i - 1)];
+		int out = i == numStages - 1 ? kInherit : fds[2 * i + 1];
+		pid_t pgid = !newGroup ? kCallersGroup : i == 0 ? 0 : pids[0];
+		pids[i] = spawnStage(argvs[i], in, out, pgid);
+		if(pids[i] == -1) return abandon(pids, i, fds, numFds);
+	}
+	closeAll(fds, numFds);
+	return newGroup ? pids[0] : getpgrp();
+}
 
 void pipeline(char *argv1[], char *argv2[], pid_t pids[]) {
-	int fds[2];
-	pipe(fds);
-	pid_t pid1 = fork();
-	if(pid1 == 0) {
-		pids[0] = pid1;
-		close(fds[0]);
-		dup2(fds[1], STDOUT_FILENO);
-		close(fds[1]);
-		execvp(argv1[0], argv1);
+	char **argvs[] = {argv1, argv2};
+	pipelinev(argvs, 2, pids, false); // in the caller's group, as pipeline always has been
+}
+
+static bool writeAll(int fd, const char *buf, size_t len) {
+	while(len > 0) {
+		ssize_t count = write(fd, buf, len);
+		if(count == -1) {
+			if(errno == EINTR) continue;
+			return false;
+		}
+		buf += count;
+		len -= count;
+	}
+	return true;
+}
+
+static void readExactly(int fd, char *buf, size_t len) {
+	while(len > 0) {
+		ssize_t count = read(fd, buf, len);
+		if(count == -1 && errno == EINTR) continue;
+		if(count <= 0) return;
+		buf += count;
+		len -= count;
+	}
+}
+
+/**
+ * Function: spliceExactly
+ * -----------------------
+ * Moves len bytes already sitting in the in pipe to out, returning
+ * how many made it before out's reader went away.
+ */
+static size_t spliceExactly(int in, int out, size_t len) {
+	size_t moved = 0;
+	while(moved < len) {
+		ssize_t count = splice(in, NULL, out, NULL, len - moved, SPLICE_F_MOVE);
+		if(count == -1 && errno == EINTR) continue;
+		if(count <= 0) break;
+		moved += count;
+	}
+	return moved;
+}
+
+/**
+ * Function: relay
+ * ---------------
+ * The body of pipeline_fanout's relay process.  Each round, the
+ * first live consumer is tee'd whatever will fit, which fixes the
+ * round's length; the other consumers but the last are tee'd that
+ * same length, and the last is spliced it, which consumes it from
+ * the producer's pipe.  tee always copies from the front of its
+ * input, so a consumer that was tee'd short can't be topped up
+ * with another tee; in that (rare) round the data is read out of
+ * the pipe and the missing tails written the ordinary way.
+ */
+static void relay(int in, int outs[], size_t numOuts) {
+	signal(SIGPIPE, SIG_IGN); // a consumer exiting early shows up as EPIPE instead
+	bool live[numOuts];
+	ssize_t sent[numOuts];
+	size_t numLive = numOuts;
+	for(size_t j = 0; j < numOuts; j++) live[j] = true;
+	char *buffer = malloc(kPipelineBufferSize);
+	if(buffer == NULL) return;
+
+	while(numLive > 0) {
+		size_t last = 0;
+		for(size_t j = 0; j < numOuts; j++) {
+			if(live[j]) last = j;
+		}
+
+		ssize_t length = -1;
+		bool shortfall = false;
+		for(size_t j = 0; j < last; j++) {
+			if(!live[j]) continue;
+			ssize_t count;
+			do {
+				count = tee(in, outs[j], length == -1 ? (size_t) kPipelineBufferSize : (size_t) length, 0);
+			} while(count == -1 && errno == EINTR);
+			if(count == -1) {
+				live[j] = false;
+				numLive--;
+				continue;
+			}
+			if(length == -1) length = count;
+			sent[j] = count;
+			if(count < length) shortfall = true;
+		}
+		if(length == 0) break; // the producer is done
+
+		if(length == -1) { // only the last consumer is left, so just splice
+			ssize_t count;
+			do {
+				count = splice(in, NULL, outs[last], NULL, kPipelineBufferSize, SPLICE_F_MOVE);
+			} while(count == -1 && errno == EINTR);
+			if(count == 0) break;
+			if(count == -1) {
+				live[last] = false;
+				numLive--;
+			}
+			continue;
+		}
+
+		if(!shortfall) {
+			size_t moved = spliceExactly(in, outs[last], length);
+			if(moved == (size_t) length) continue;
+			live[last] = false; // it's gone, but the rest of the round must still leave the pipe
+			numLive--;
+			readExactly(in, buffer, length - moved);
+			continue;
+		}
+
+		readExactly(in, buffer, length);
+		for(size_t j = 0; j < last; j++) {
+			if(live[j] && sent[j] < length && !writeAll(outs[j], buffer + sent[j], length - sent[j])) {
+				live[j] = false;
+				numLive--;
+			}
+		}
+		if(!writeAll(outs[last], buffer, length)) {
+			live[last] = false;
+			numLive--;
+		}
 	}
-	pid_t pid2 = fork();
-	if(pid2 == 0) {
-		pids[1] = pid2;
+	free(buffer);
+}
+
+static pid_t spawnRelay(int in, int outs[], size_t numOuts, int fds[], size_t numFds, pid_t pgid) {
+	pid_t pid = fork();
+	if(pid == 0) {
+		joinGroup(0, pgid);
+		// keep only the producer's read end and the consumers' write ends
 		close(fds[1]);
-		dup2(fds[0], STDIN_FILENO);
-		close(fds[0]);
-		execvp(argv2[0], argv2);
+		for(size_t j = 0; j < numOuts; j++) close(fds[2 * (j + 1)]);
+		relay(in, outs, numOuts);
+		_exit(0); // not exit, which would flush the parent's buffered output a second time
+	}
+	if(pid > 0) joinGroup(pid, pgid);
+	return pid;
+}
+
+pid_t pipeline_fanout(char *producer[], char **consumers[], size_t numConsumers, pid_t pids[]) {
+	if(numConsumers == 0) return -1;
+	// fds[0..1] is the producer's pipe; fds[2j+2..2j+3] is consumer j's
+	size_t numFds = 2 * (numConsumers + 1);
+	int fds[numFds];
+	int outs[numConsumers];
+	for(size_t i = 0; i <= numConsumers; i++) {
+		if(makePipe(fds + 2 * i) == -1) return abandon(pids, 0, fds, 2 * i);
+	}
+	for(size_t j = 0; j < numConsumers; j++) outs[j] = fds[2 * (j + 1) + 1];
+
+	pids[0] = spawnStage(producer, kInherit, fds[1], 0);
+	if(pids[0] == -1) return abandon(pids, 0, fds, numFds);
+	pids[1] = spawnRelay(fds[0], outs, numConsumers, fds, numFds, pids[0]);
+	if(pids[1] == -1) return abandon(pids, 1, fds, numFds);
+	for(size_t j = 0; j < numConsumers; j++) {
+		pids[j + 2] = spawnStage(consumers[j], fds[2 * (j + 1)], kInherit, pids[0]);
+		if(pids[j + 2] == -1) return abandon(pids, j + 2, fds, numFds);
 	}
-	close(fds[0]);
-	close(fds[1]);
+	closeAll(fds, numFds);
+	return pids[0];
 }
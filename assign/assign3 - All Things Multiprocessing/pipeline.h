@@ -17,14 +17,29 @@
        return 0;
      }
 
- *
+ * Also exports pipelinev, which does the same for any
+ * number of stages, and pipeline_fanout, which delivers
+ * one command's output to several consumers at once.
  */
 
 #ifndef _pipeline_h_
 #define _pipeline_h_
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <unistd.h>
 
+/**
+ * Constant: kPipelineBufferSize
+ * -----------------------------
+ * The capacity every pipe created here is enlarged to (via F_SETPIPE_SZ),
+ * so that a fast writer can run well ahead of a slow reader before blocking.
+ * The default is 64KB.  Enlarging is best-effort: anything over
+ * /proc/sys/fs/pipe-max-size is refused for unprivileged processes, and
+ * the pipe is then left at its default size.
+ */
+static const int kPipelineBufferSize = 1 << 20;
+
 /**
  * Function: pipeline
  * ------------------
@@ -33,9 +48,52 @@
  * vector supplied via argv2, and places the process ids of
  * each in pids[0] and pids[1].  Furthermore, the standard
  * output of the first process is piped to the standard input
- * of the second process.
+ * of the second process.  Both stay in the caller's process
+ * group, so either can read from the terminal while the caller
+ * is in the foreground.
  */
 
 void pipeline(char *argv1[], char *argv2[], pid_t pids[]);
 
+/**
+ * Function: pipelinev
+ * -------------------
+ * Spawns numStages processes, the ith around the argument
+ * vector argvs[i], with the standard output of each piped to
+ * the standard input of the next, and places their process ids
+ * in pids[0] through pids[numStages - 1].  If newGroup is true,
+ * all of them are placed in a new process group whose id is
+ * pids[0], so the pipeline can be signaled as a unit via
+ * kill(-pids[0], sig).  Note that a background group that reads
+ * from the terminal is stopped by SIGTTIN, so a caller that wants
+ * the first stage to read the terminal must either pass false,
+ * which leaves every stage in the caller's own group, or hand the
+ * terminal to the new group with tcsetpgrp.  Returns the stages'
+ * process group id, or -1 (with nothing left running) if a pipe
+ * or process couldn't be created.
+ */
+
+pid_t pipelinev(char **argvs[], size_t numStages, pid_t pids[], bool newGroup);
+
+/**
+ * Function: pipeline_fanout
+ * -------------------------
+ * Spawns a producer around the argument vector producer and
+ * numConsumers consumers around consumers[0] through
+ * consumers[numConsumers - 1], each of which receives a complete
+ * copy of the producer's standard output.  The copies are made by
+ * a relay process that runs no executable of its own: it tee(2)s
+ * the producer's pipe into every consumer's pipe but the last and
+ * splice(2)s it into the last, so the data is never copied through
+ * user space unless some consumer's pipe is too full to take its
+ * share whole.  A consumer that exits early simply stops receiving.
+ *
+ * pids receives numConsumers + 2 process ids: the producer's, then
+ * the relay's, then the consumers' in order.  As with pipelinev
+ * when newGroup is true, all of them share a new process group
+ * whose id is returned (or -1 on failure).
+ */
+
+pid_t pipeline_fanout(char *producer[], char **consumers[], size_t numConsumers, pid_t pids[]);
+
 #endif
@@ -0,0 +1,45 @@
+/**
+ * File: simple-test6.cc
+ * ---------------------
+ * Presents the implementation of a short nonsense program that makes a small number of
+ * system calls.  The program can be run standalone, but it's really designed to be fed as
+ * an argument to the trace executable, as with:
+ *
+ *    > ./trace -e write,openat ./simple-test6
+ *
+ * This test is useful for confirming that -e doesn't break the processes the tracee
+ * creates.  They inherit its seccomp filter, and if trace doesn't follow them, every call
+ * the filter selects fails with ENOSYS.  Each child makes those calls, one of them after
+ * exec'ing /bin/echo (whose dynamic loader has to open libc), and the program exits with
+ * status 0 only if they all succeeded.  Without -f, trace should report none of the
+ * children's calls.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static bool childSucceeded(pid_t pid) {
+  int status;
+  return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    bool wrote = write(STDOUT_FILENO, "child\n", 6) == 6;
+    int fd = open(__FILE__, O_RDONLY);
+    _exit(wrote && fd != -1 ? 0 : 1);
+  }
+  bool succeeded = childSucceeded(pid);
+
+  pid = fork();
+  if (pid == 0) {
+    execl("/bin/echo", "echo", "echoed", (char *) NULL);
+    _exit(1);
+  }
+  succeeded = childSucceeded(pid) && succeeded;
+
+  write(STDOUT_FILENO, succeeded ? "children succeeded\n" : "children failed\n", succeeded ? 19 : 16);
+  return succeeded ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/**
+ * File: spawn-benchmark.cc
+ * ------------------------
+ * Measures how many subprocesses per second subprocess can spawn (and reap)
+ * as the parent's resident set grows, once with each spawn mode.  fork must
+ * copy the parent's page tables, so its rate falls as the parent grows;
+ * posix_spawn shares the parent's memory until the exec and shouldn't care.
+ *
+ *    > ./spawn-benchmark [--spawns=<n>] [<rss-in-MB> ...]
+ *
+ * The resident set sizes default to 10, 100 and 1000 MB.  Larger ones (say
+ * 10000) can be passed explicitly on machines with the memory for them.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "subprocess.h"
+using namespace std;
+
+static const char *kChildArguments[] = {"/bin/true", NULL};
+static const size_t kBytesPerMB = 1 << 20;
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Function: spawnsPerSecond
+ * -------------------------
+ * Spawns and reaps numSpawns children one after another, returning the rate.
+ * The child's stdin and stdout are both piped so the file actions are
+ * exercised too.
+ */
+static double spawnsPerSecond(spawnmode_t mode, size_t numSpawns) {
+	setSubprocessSpawnMode(mode);
+	double start = now();
+	for (size_t i = 0; i < numSpawns; i++) {
+		subprocess_t sp = subprocess(const_cast<char **>(kChildArguments), true, true);
+		close(sp.supplyfd);
+		close(sp.ingestfd);
+		waitpid(sp.pid, NULL, 0);
+	}
+	double elapsed = now() - start;
+	return elapsed > 0 ? numSpawns / elapsed : 0;
+}
+
+int main(int argc, char *argv[]) {
+	size_t numSpawns = 200;
+	vector<size_t> sizes;
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--spawns=", strlen("--spawns=")) == 0) {
+			numSpawns = atoi(argv[i] + strlen("--spawns="));
+		} else {
+			sizes.push_back(atol(argv[i]));
+		}
+	}
+	if (sizes.empty()) sizes = {10, 100, 1000};
+
+	try {
+		cout << setw(10) << "RSS (MB)" << setw(16) << "fork/s" << setw(16) << "posix_spawn/s" << endl;
+		vector<char *> blocks;
+		size_t resident = 0;
+		for (size_t mb: sizes) {
+			// grow the parent to mb, touching every page so it's really resident
+			while (resident < mb) {
+				char *block = static_cast<char *>(malloc(kBytesPerMB));
+				if (block == NULL) break;
+				memset(block, 1, kBytesPerMB);
+				blocks.push_back(block);
+				resident++;
+			}
+			if (resident < mb) {
+				cerr << "Couldn't grow to " << mb << " MB; stopping." << endl;
+				break;
+			}
+
+			double forkRate = spawnsPerSecond(kSpawnFork, numSpawns);
+			double posixRate = spawnsPerSecond(kSpawnPosix, numSpawns);
+			cout << setw(10) << mb << fixed << setprecision(1) << setw(16) << forkRate << setw(16) << posixRate << endl;
+		}
+		for (char *block: blocks) free(block);
+		return 0;
+	} catch (const SubprocessException& se) {
+		cerr << "Problem encountered while spawning: " << se.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,127 @@
+/**
+ * File: subprocess-manager-test.cc
+ * --------------------------------
+ * Exercises the SubprocessManager: lots of children at once, a child that's
+ * fed input, a child that's signaled, and handlers that spawn more children.
+ */
+
+#include "subprocess-manager.h"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+using namespace std;
+
+static int failures = 0;
+static void check(bool condition, const string& description) {
+	if (!condition) {
+		cout << "FAILED: " << description << endl;
+		failures++;
+	}
+}
+
+/**
+ * Function: testManyChildren
+ * --------------------------
+ * Launches a few hundred echo processes all at once and confirms that each
+ * one's output and exit are reported, and in that order.
+ */
+static void testManyChildren() {
+	static const int kNumChildren = 500;
+	SubprocessManager manager;
+	map<pid_t, string> expected, output;
+	map<pid_t, int> statuses;
+	for (int i = 0; i < kNumChildren; i++) {
+		string number = to_string(i);
+		char *argv[] = {const_cast<char *>("/bin/echo"), const_cast<char *>(number.c_str()), NULL};
+		subprocess_t sp = manager.spawn(argv, false,
+			[&](pid_t pid, int status) { statuses[pid] = status; },
+			[&](pid_t pid, const string& chunk) {
+				check(statuses.count(pid) == 0, "output arrives before exit");
+				output[pid] += chunk;
+			});
+		expected[sp.pid] = number + "\n";
+	}
+	check(manager.size() == kNumChildren, "every child is tracked");
+	manager.run();
+	check(manager.size() == 0, "every child is retired");
+	check(output == expected, "every child's output is delivered intact");
+	check(statuses.size() == kNumChildren, "every child's exit is reported");
+	for (const pair<const pid_t, int>& p: statuses) {
+		check(WIFEXITED(p.second) && WEXITSTATUS(p.second) == 0, "echo exits cleanly");
+	}
+}
+
+/**
+ * Function: testSuppliedInput
+ * ---------------------------
+ * Pipes words to sort and confirms they come back sorted.
+ */
+static void testSuppliedInput() {
+	SubprocessManager manager;
+	char *argv[] = {const_cast<char *>("sort"), NULL};
+	string sorted;
+	bool exited = false;
+	subprocess_t sp = manager.spawn(argv, true,
+		[&](pid_t pid, int status) { exited = WIFEXITED(status) && WEXITSTATUS(status) == 0; },
+		[&](pid_t pid, const string& chunk) { sorted += chunk; });
+	string words = "put\na\nring\non\nit\n";
+	check(write(sp.supplyfd, words.c_str(), words.size()) == (ssize_t) words.size(), "words are written to sort");
+	close(sp.supplyfd);
+	manager.run();
+	check(exited, "sort exits cleanly");
+	check(sorted == "a\nit\non\nput\nring\n", "sort's output is delivered");
+}
+
+/**
+ * Function: testSignal
+ * --------------------
+ * Kills a sleeping child through its pidfd and confirms the exit says so.
+ */
+static void testSignal() {
+	SubprocessManager manager;
+	char *argv[] = {const_cast<char *>("sleep"), const_cast<char *>("100"), NULL};
+	int status = 0;
+	subprocess_t sp = manager.spawn(argv, false, [&](pid_t pid, int s) { status = s; });
+	check(manager.dispatch(0) == 0, "a sleeping child produces no events");
+	check(manager.signal(sp.pid, SIGKILL), "the child can be signaled");
+	manager.run();
+	check(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL, "the exit reports SIGKILL");
+	check(!manager.signal(sp.pid, SIGKILL), "a retired child can't be signaled");
+}
+
+/**
+ * Function: testChainedSpawns
+ * ---------------------------
+ * Has each exit handler spawn the next child, as a work queue would.
+ */
+static void testChainedSpawns() {
+	static const int kChainLength = 20;
+	SubprocessManager manager;
+	char *argv[] = {const_cast<char *>("/bin/true"), NULL};
+	int completed = 0;
+	function<void(pid_t, int)> onExit = [&](pid_t pid, int status) {
+		if (++completed < kChainLength) manager.spawn(argv, false, onExit);
+	};
+	manager.spawn(argv, false, onExit);
+	manager.run();
+	check(completed == kChainLength, "every chained child runs");
+}
+
+int main(int argc, char *argv[]) {
+	try {
+		testManyChildren();
+		testSuppliedInput();
+		testSignal();
+		testChainedSpawns();
+	} catch (const SubprocessException& se) {
+		cerr << "Problem encountered while managing subprocesses." << endl;
+		cerr << "Cause: " << se.what() << endl;
+		return 1;
+	}
+	cout << (failures == 0 ? "All tests passed." : to_string(failures) + " checks failed.") << endl;
+	return failures == 0 ? 0 : 1;
+}
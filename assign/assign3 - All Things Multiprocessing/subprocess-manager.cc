@@ -0,0 +1,180 @@
+/**
+ * File: subprocess-manager.cc
+ * ---------------------------
+ * Presents the implementation of the SubprocessManager class.  Every
+ * descriptor registered with the epoll instance is either a child's pidfd,
+ * which becomes readable once the child exits, or the read end of a child's
+ * stdout pipe; owners maps each back to its child.
+ */
+
+#include "subprocess-manager.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+static const int kMaxEvents = 64;
+static const size_t kReadSize = 4096;
+
+/**
+ * pidfd_open and pidfd_send_signal only got glibc wrappers in 2.36, so
+ * they're invoked directly.
+ */
+static int pidfdOpen(pid_t pid) {
+  return syscall(SYS_pidfd_open, pid, 0);
+}
+
+static int pidfdSendSignal(int pidfd, int sig) {
+  return syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+}
+
+SubprocessManager::SubprocessManager() throw (SubprocessException) {
+  epollfd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollfd == -1) {
+    throw SubprocessException(string("Could not create epoll instance: ") + strerror(errno));
+  }
+}
+
+SubprocessManager::~SubprocessManager() {
+  for (const pair<const int, pid_t>& p: owners) close(p.first);
+  close(epollfd);
+}
+
+subprocess_t SubprocessManager::spawn(char *argv[], bool supplyChildInput, const ExitHandler& onExit,
+                                      const OutputHandler& onOutput) throw (SubprocessException) {
+  bool ingest = static_cast<bool>(onOutput);
+  subprocess_t sp = subprocess(argv, supplyChildInput, ingest);
+
+  // the child can't be reaped by anyone but us, so its pid can't be recycled before this
+  int pidfd = pidfdOpen(sp.pid);
+  if (pidfd == -1) {
+    int err = errno;
+    if (sp.supplyfd != kNotInUse) close(sp.supplyfd);
+    if (sp.ingestfd != kNotInUse) close(sp.ingestfd);
+    kill(sp.pid, SIGKILL);
+    waitpid(sp.pid, NULL, 0);
+    throw SubprocessException(string("Could not open pidfd for ") + argv[0] + ": " + strerror(err));
+  }
+
+  child& c = children[sp.pid];
+  c.pidfd = pidfd;
+  c.ingestfd = sp.ingestfd;
+  c.reaped = false;
+  c.status = 0;
+  c.onExit = onExit;
+  c.onOutput = onOutput;
+  watch(pidfd, sp.pid);
+  if (sp.ingestfd != kNotInUse) {
+    fcntl(sp.ingestfd, F_SETFL, fcntl(sp.ingestfd, F_GETFL) | O_NONBLOCK);
+    watch(sp.ingestfd, sp.pid);
+  }
+
+  sp.ingestfd = kNotInUse;
+  return sp;
+}
+
+bool SubprocessManager::signal(pid_t pid, int sig) {
+  auto found = children.find(pid);
+  if (found == children.end() || found->second.reaped) return false;
+  return pidfdSendSignal(found->second.pidfd, sig) == 0;
+}
+
+size_t SubprocessManager::dispatch(int timeout) throw (SubprocessException) {
+  if (owners.empty()) return 0;
+  struct epoll_event events[kMaxEvents];
+  int count = epoll_wait(epollfd, events, kMaxEvents, timeout);
+  if (count == -1) {
+    if (errno == EINTR) return 0;
+    throw SubprocessException(string("epoll_wait failed: ") + strerror(errno));
+  }
+
+  for (int i = 0; i < count; i++) {
+    // an earlier handler in this batch may have retired the descriptor, or even handed its
+    // number to a new child, which is why neither handler below ever blocks
+    auto owner = owners.find(events[i].data.fd);
+    if (owner == owners.end()) continue;
+    pid_t pid = owner->second;
+    const child& c = children[pid];
+    if (events[i].data.fd == c.pidfd) {
+      handlePidfd(pid);
+    } else if (events[i].data.fd == c.ingestfd) {
+      handleOutput(pid);
+    }
+  }
+  return count;
+}
+
+void SubprocessManager::run() throw (SubprocessException) {
+  while (!children.empty()) dispatch();
+}
+
+void SubprocessManager::watch(int fd, pid_t pid) throw (SubprocessException) {
+  struct epoll_event info;
+  memset(&info, 0, sizeof(info));
+  info.events = EPOLLIN;
+  info.data.fd = fd;
+  if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &info) == -1) {
+    throw SubprocessException(string("Could not watch descriptor: ") + strerror(errno));
+  }
+  owners[fd] = pid;
+}
+
+void SubprocessManager::unwatch(int fd) {
+  epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL);
+  owners.erase(fd);
+  close(fd);
+}
+
+/**
+ * Method: handlePidfd
+ * -------------------
+ * The child has exited, so reap it.  Its exit is only reported once any
+ * output it left behind in the pipe has been drained.
+ */
+void SubprocessManager::handlePidfd(pid_t pid) {
+  child& c = children[pid];
+  pid_t reaped = waitpid(pid, &c.status, WNOHANG);
+  if (reaped == 0) return;
+  if (reaped != pid) {
+    throw SubprocessException("Child " + to_string(pid) + " was reaped by someone else.");
+  }
+  c.reaped = true;
+  unwatch(c.pidfd);
+  c.pidfd = kNotInUse;
+  if (c.ingestfd == kNotInUse) finish(pid);
+}
+
+/**
+ * Method: handleOutput
+ * --------------------
+ * Forwards one read's worth of output.  epoll is level-triggered, so
+ * anything left over will be reported again on the next dispatch.
+ */
+void SubprocessManager::handleOutput(pid_t pid) {
+  child& c = children[pid];
+  char buffer[kReadSize];
+  ssize_t count = read(c.ingestfd, buffer, sizeof(buffer));
+  if (count == -1 && (errno == EINTR || errno == EAGAIN)) return;
+  if (count > 0) {
+    OutputHandler onOutput = c.onOutput; // the handler may spawn, which can rehash children
+    onOutput(pid, string(buffer, count));
+    return;
+  }
+
+  unwatch(c.ingestfd);
+  c.ingestfd = kNotInUse;
+  if (c.reaped) finish(pid);
+}
+
+void SubprocessManager::finish(pid_t pid) {
+  auto found = children.find(pid);
+  ExitHandler onExit = found->second.onExit;
+  int status = found->second.status;
+  children.erase(found);
+  if (onExit) onExit(pid, status);
+}
@@ -0,0 +1,131 @@
+/**
+ * File: subprocess-manager.h
+ * --------------------------
+ * Exports a SubprocessManager, which spawns children via subprocess and then
+ * supervises all of them from a single thread: each child's pidfd and (if
+ * requested) the read end of its stdout pipe are registered with one epoll
+ * instance, and exits and output are handed to per-child callbacks as they
+ * happen.  No SIGCHLD handler or blocking waitpid is involved, so a
+ * manager can oversee thousands of children without any of them waiting
+ * on any other.
+ *
+ * Children must be reaped only by the manager that spawned them: anything
+ * else calling waitpid(-1, ...) will steal exits the manager is waiting
+ * to see.
+ */
+
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+#include "subprocess.h"
+
+class SubprocessManager {
+ public:
+  /**
+   * Type: ExitHandler
+   * -----------------
+   * Invoked once per child after it's been reaped, with its pid and the status
+   * waitpid reported.  If the child's output is being ingested, the handler isn't
+   * invoked until that output has been drained to end of file, so every
+   * OutputHandler call for a child precedes its ExitHandler call.
+   */
+  typedef std::function<void(pid_t pid, int status)> ExitHandler;
+
+  /**
+   * Type: OutputHandler
+   * -------------------
+   * Invoked with whatever the child has written to its stdout since the last call,
+   * in arbitrary-sized chunks (lines may be split across calls).  At end of file
+   * the manager closes the descriptor itself; the handler is not invoked for EOF.
+   */
+  typedef std::function<void(pid_t pid, const std::string& chunk)> OutputHandler;
+
+  /**
+   * Constructor: SubprocessManager
+   * ------------------------------
+   * Creates the epoll instance all children will be registered with.
+   * Throws a SubprocessException if that's not possible.
+   */
+  SubprocessManager() throw (SubprocessException);
+
+  /**
+   * Destructor: ~SubprocessManager
+   * ------------------------------
+   * Closes every descriptor the manager still owns.  Children that are still
+   * running are neither killed nor reaped.
+   */
+  ~SubprocessManager();
+
+  /**
+   * Method: spawn
+   * -------------
+   * Launches argv as subprocess would and takes charge of it.  If onOutput is
+   * supplied, the child's stdout is ingested and forwarded to it; otherwise the
+   * child shares the parent's stdout.  If supplyChildInput is true, the returned
+   * subprocess_t's supplyfd belongs to the caller, who should close it when
+   * done writing.  The returned ingestfd is always kNotInUse, since the manager
+   * owns it.  Throws a SubprocessException if the child can't be launched or
+   * can't be watched.
+   */
+  subprocess_t spawn(char *argv[], bool supplyChildInput, const ExitHandler& onExit,
+                     const OutputHandler& onOutput = OutputHandler()) throw (SubprocessException);
+
+  /**
+   * Method: signal
+   * --------------
+   * Sends sig to the child with the provided pid by way of its pidfd, so the
+   * signal can never land on some unrelated process that reused the pid.
+   * Returns false if pid isn't a live child of this manager or the signal
+   * couldn't be sent.
+   */
+  bool signal(pid_t pid, int sig);
+
+  /**
+   * Method: dispatch
+   * ----------------
+   * Waits up to timeout milliseconds (-1 means indefinitely) for something to
+   * happen to any child, invokes the handlers for whatever did, and returns the
+   * number of events handled (0 on timeout).  Handlers may spawn new children.
+   */
+  size_t dispatch(int timeout = -1) throw (SubprocessException);
+
+  /**
+   * Method: run
+   * -----------
+   * Dispatches events until every child spawned so far (and every child spawned
+   * by a handler along the way) has exited and been reported.
+   */
+  void run() throw (SubprocessException);
+
+  /**
+   * Method: size
+   * ------------
+   * Returns the number of children whose ExitHandler has yet to be invoked.
+   */
+  size_t size() const { return children.size(); }
+
+ private:
+  struct child {
+    int pidfd;
+    int ingestfd;
+    bool reaped;
+    int status;
+    ExitHandler onExit;
+    OutputHandler onOutput;
+  };
+
+  int epollfd;
+  std::unordered_map<pid_t, child> children;
+  std::unordered_map<int, pid_t> owners; // every registered descriptor -> owning pid
+
+  void watch(int fd, pid_t pid) throw (SubprocessException);
+  void unwatch(int fd);
+  void handlePidfd(pid_t pid);
+  void handleOutput(pid_t pid);
+  void finish(pid_t pid);
+
+  SubprocessManager(const SubprocessManager& original) = delete;
+  SubprocessManager& operator=(const SubprocessManager& rhs) = delete;
+};
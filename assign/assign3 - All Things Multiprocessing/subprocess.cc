@@ -5,7 +5,18 @@
  */
 
 #include "subprocess.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <string>
 using namespace std;
+
+static spawnmode_t spawnMode = kSpawnPosix;
+
+void setSubprocessSpawnMode(spawnmode_t mode) {
+	spawnMode = mode;
+}
 int Pipe(int pipefd[2]) {
 	int p = pipe(pipefd);
 	if(p == -1) {
@@ -47,7 +58,56 @@ void Execvp(const char* file, char* const argv[]) {
 	}
 }
 
+/**
+ * Function: posixSubprocess
+ * -------------------------
+ * The kSpawnPosix backend.  Only the pipes that are asked for are created,
+ * close-on-exec, so the file actions need only dup2 their child ends into
+ * place; dup2 clears close-on-exec on the copy, and every other pipe end
+ * disappears at the exec.  Returns false, having created nothing, if the
+ * spawn attributes can't be set up, in which case the caller falls back
+ * to fork.
+ */
+static bool posixSubprocess(char *argv[], bool supplyChildInput, bool ingestChildOutput, subprocess_t& sp) throw (SubprocessException) {
+	posix_spawn_file_actions_t actions;
+	if(posix_spawn_file_actions_init(&actions) != 0) return false;
+
+	int supply_fds[2] = {kNotInUse, kNotInUse};
+	int ingest_fds[2] = {kNotInUse, kNotInUse};
+	bool ok = true;
+	if(supplyChildInput) {
+		ok = pipe2(supply_fds, O_CLOEXEC) == 0 &&
+			posix_spawn_file_actions_adddup2(&actions, supply_fds[0], STDIN_FILENO) == 0;
+	}
+	if(ok && ingestChildOutput) {
+		ok = pipe2(ingest_fds, O_CLOEXEC) == 0 &&
+			posix_spawn_file_actions_adddup2(&actions, ingest_fds[1], STDOUT_FILENO) == 0;
+	}
+
+	int err = ok ? posix_spawnp(&sp.pid, argv[0], &actions, NULL, argv, environ) : 0;
+	posix_spawn_file_actions_destroy(&actions);
+	for(int fd: {supply_fds[0], ingest_fds[1]}) {
+		if(fd != kNotInUse) close(fd);
+	}
+	if(!ok || err != 0) {
+		for(int fd: {supply_fds[1], ingest_fds[0]}) {
+			if(fd != kNotInUse) close(fd);
+		}
+		if(!ok) return false;
+		throw SubprocessException(string("Could not spawn ") + argv[0] + ": " + strerror(err));
+	}
+
+	sp.supplyfd = supply_fds[1];
+	sp.ingestfd = ingest_fds[0];
+	return true;
+}
+
 subprocess_t subprocess(char *argv[], bool supplyChildInput, bool ingestChildOutput) throw (SubprocessException) {
+	if(spawnMode == kSpawnPosix) {
+		struct subprocess_t sp = {0, kNotInUse, kNotInUse};
+		if(posixSubprocess(argv, supplyChildInput, ingestChildOutput, sp)) return sp;
+	}
+
 	int supply_fds[2];
 	int ingest_fds[2];
 	Pipe(supply_fds);
@@ -76,9 +136,15 @@ subprocess_t subprocess(char *argv[], bool supplyChildInput, bool ingestChildOut
 		Close(ingest_fds[1]);
 		if(supplyChildInput) {
 			sp.supplyfd = supply_fds[1];
+			fcntl(sp.supplyfd, F_SETFD, FD_CLOEXEC);
+		} else {
+			Close(supply_fds[1]);
 		}
 		if(ingestChildOutput) {
 			sp.ingestfd = ingest_fds[0];
+			fcntl(sp.ingestfd, F_SETFD, FD_CLOEXEC);
+		} else {
+			Close(ingest_fds[0]);
 		}
 	}
 	return sp;
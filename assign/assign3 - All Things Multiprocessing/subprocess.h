@@ -80,6 +80,26 @@ struct subprocess_t {
   int ingestfd;
 };
  
+/**
+ * Type: spawnmode_t
+ * -----------------
+ * Identifies how subprocess creates the new process.
+ *
+ *  kSpawnPosix: posix_spawnp, with file actions rewiring stdin and stdout.  glibc implements
+ *               it with clone(CLONE_VM|CLONE_VFORK), so the parent's page tables are never
+ *               copied and spawning costs the same however large the parent is.  The default.
+ *  kSpawnFork: fork, then rewire and execvp in the child.  The cost of the fork grows with the
+ *              parent's resident set.  Also used whenever posix_spawnp can't be set up.
+ */
+enum spawnmode_t { kSpawnPosix, kSpawnFork };
+
+/**
+ * Function: setSubprocessSpawnMode
+ * --------------------------------
+ * Selects how every later call to subprocess creates its process.
+ */
+void setSubprocessSpawnMode(spawnmode_t mode);
+
 /**
  * Function: subprocess
  * --------------------
@@ -88,5 +108,7 @@ struct subprocess_t {
  *   argv: the NULL-terminated argument vector that should be passed to the new process's main function
  *   supplyChildInput: true if the parent process would like to pipe content to the new process's stdin, false otherwise
  *   ingestChildOutput: true if the parent would like the child's stdout to be pushed to the parent, false otheriwse
+ *
+ * The descriptors handed back are close-on-exec, so later children don't inherit them.
  */
 subprocess_t subprocess(char *argv[], bool supplyChildInput, bool ingestChildOutput) throw (SubprocessException);
@@ -0,0 +1,58 @@
+/**
+ * File: syscall-benchmark.cc
+ * --------------------------
+ * A deliberately system-call-heavy program for measuring what trace adds to
+ * each system call it traces.  Each iteration makes four calls, two of which
+ * hand the kernel something trace has to copy out of our memory: an access on
+ * a long pathname, a 4KB write, a 4KB read, and a getpid.  The time per
+ * system call is reported on stderr, so trace's own output can be thrown away:
+ *
+ *    > ./syscall-benchmark 20000
+ *    > ./trace ./syscall-benchmark 20000 > /dev/null
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <unistd.h>
+using namespace std;
+
+static const int kSyscallsPerIteration = 4;
+static const size_t kBufferSize = 4096;
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  string path = "/tmp";
+  while (path.size() < 200) path += "/no-such-directory";
+
+  int devnull = open("/dev/null", O_WRONLY);
+  int devzero = open("/dev/zero", O_RDONLY);
+  if (devnull == -1 || devzero == -1) {
+    perror("open");
+    return 1;
+  }
+
+  char buffer[kBufferSize] = {'x'};
+  double start = now();
+  for (int i = 0; i < iterations; i++) {
+    access(path.c_str(), F_OK);
+    if (write(devnull, buffer, sizeof(buffer)) == -1) perror("write");
+    if (read(devzero, buffer, sizeof(buffer)) == -1) perror("read");
+    getpid();
+  }
+  double elapsed = now() - start;
+
+  close(devnull);
+  close(devzero);
+  fprintf(stderr, "%d system calls in %.3f seconds: %.2f microseconds per call\n",
+          iterations * kSyscallsPerIteration, elapsed, elapsed * 1e6 / (iterations * kSyscallsPerIteration));
+  return 0;
+}
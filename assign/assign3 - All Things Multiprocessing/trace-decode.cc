@@ -0,0 +1,151 @@
+/**
+ * File: trace-decode.cc
+ * ---------------------
+ * Prints a trace file written by trace --record=<file> just as trace would have
+ * printed the calls it records, had it been printing them as it went:
+ *
+ *    > ./trace --record=ls.trc ls > /dev/null
+ *    > ./trace-decode ls.trc
+ *
+ * System call names, signatures and error names come from the tables compiled
+ * into trace-decode (see trace-tables.h), so a trace file should be decoded on
+ * the kind of machine that recorded it.
+ */
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include "trace-record.h"
+#include "trace-tables.h"
+using namespace std;
+
+static bool follow = false;
+static pid_t unfinished = 0; // as in trace.cc: the thread whose entry line is still open
+
+static string sysCallName(long number) {
+  if (number < 0 || number >= (long) kSystemCallTableSize || kSystemCallTable[number].name == NULL) return "";
+  return kSystemCallTable[number].name;
+}
+
+static void finishLine() {
+  if (unfinished == 0) return;
+  cout << "<unfinished ...>\n";
+  unfinished = 0;
+}
+
+static void startLine(pid_t tid) {
+  finishLine();
+  if (follow) cout << "[" << tid << "] ";
+}
+
+static void resumeLine(pid_t tid, long number) {
+  if (unfinished != tid) {
+    startLine(tid);
+    cout << "<... " << sysCallName(number) << " resumed> ";
+  }
+  unfinished = 0;
+}
+
+/**
+ * Function: printEntry
+ * --------------------
+ * Prints the name and arguments of the call an entry record describes.  The
+ * strings come out of the record's payload, keyed by argument number.
+ */
+static void printEntry(const traceRecord& record, const string& payload) {
+  map<unsigned int, string> strings;
+  for (size_t pos = 0; pos + sizeof(traceString) <= payload.size();) {
+    traceString header;
+    memcpy(&header, payload.data() + pos, sizeof(header));
+    pos += sizeof(header);
+    strings[header.argument] = "\"" + payload.substr(pos, header.length) + (header.truncated ? "\"..." : "\"");
+    pos += header.length;
+  }
+
+  startLine(record.tid);
+  cout << sysCallName(record.number) << "(";
+  bool known = record.number >= 0 && record.number < (long) kSystemCallTableSize;
+  int numParams = known ? kSystemCallTable[record.number].numParams : -1;
+  if (numParams <= 0) cout << "<signature-information-missing>";
+  for (int i = 0; i < numParams; i++) {
+    switch (kSystemCallTable[record.number].params[i]) {
+      case SYSCALL_INTEGER: cout << (long) record.values[i]; break;
+      case SYSCALL_STRING: cout << strings[i]; break;
+      case SYSCALL_POINTER:
+        if (record.values[i] == 0) cout << "NULL";
+        else cout << "0x" << hex << record.values[i] << dec;
+        break;
+      default: cout << "?"; break;
+    }
+    if (i != numParams - 1) cout << ", ";
+  }
+  cout << ") ";
+  unfinished = record.tid;
+}
+
+static void printResult(long returnValue) {
+  cout << "= ";
+  if (returnValue < 0) {
+    long error = -returnValue;
+    const char *name = error < (long) kErrorNameTableSize ? kErrorNameTable[error] : NULL;
+    cout << -1 << " " << (name != NULL ? name : "") << " (" << strerror(error) << ")";
+  } else if (returnValue <= INT_MAX) {
+    cout << returnValue;
+  } else {
+    cout << "0x" << hex << returnValue << dec;
+  }
+  cout << "\n";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    cerr << "Usage: " << argv[0] << " <trace-file>" << endl;
+    return 1;
+  }
+
+  ifstream in(argv[1], ios::binary);
+  if (!in) {
+    cerr << "Couldn't open \"" << argv[1] << "\"." << endl;
+    return 1;
+  }
+  traceFileHeader header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      memcmp(header.magic, kTraceFileMagic, sizeof(kTraceFileMagic)) != 0 || header.version != kTraceFileVersion) {
+    cerr << "\"" << argv[1] << "\" isn't a trace file (or is from another version of trace)." << endl;
+    return 1;
+  }
+  follow = header.follow != 0;
+
+  traceRecord record;
+  bool partial = false;
+  while (in.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+    string payload(record.payloadLength, '\0');
+    if (!in.read(&payload[0], payload.size())) {
+      partial = true;
+      break;
+    }
+    switch (record.kind) {
+      case kRecordEntry:
+        printEntry(record, payload);
+        break;
+      case kRecordExit:
+        resumeLine(record.tid, record.number);
+        printResult(record.values[0]);
+        break;
+      case kRecordNoReturn:
+        resumeLine(record.tid, record.number);
+        cout << "= <no return>\n";
+        break;
+    }
+  }
+  finishLine();
+
+  if (partial || in.gcount() != 0) {
+    cerr << "\"" << argv[1] << "\" ends with a partial record." << endl;
+    return 1;
+  }
+  return 0;
+}
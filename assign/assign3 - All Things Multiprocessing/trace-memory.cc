@@ -0,0 +1,105 @@
+/**
+ * File: trace-memory.cc
+ * ---------------------
+ * Presents the implementation of the functions exported by trace-memory.h.
+ */
+
+#include "trace-memory.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <unistd.h>
+using namespace std;
+
+static const size_t kMaxIovecs = 64;
+
+static unsigned long pageSize() {
+  static const unsigned long size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+static unsigned long bytesLeftInPage(unsigned long addr) {
+  return pageSize() - (addr & (pageSize() - 1));
+}
+
+/**
+ * Function: peekTraceeMemory
+ * --------------------------
+ * The PTRACE_PEEKDATA fallback: one system call per aligned word.
+ */
+static size_t peekTraceeMemory(pid_t pid, unsigned long addr, void *buffer, size_t len) {
+  char *dest = static_cast<char *>(buffer);
+  size_t copied = 0;
+  while (copied < len) {
+    unsigned long at = addr + copied;
+    unsigned long aligned = at & ~(sizeof(long) - 1);
+    errno = 0;
+    long word = ptrace(PTRACE_PEEKDATA, pid, aligned, 0);
+    if (errno != 0) break;
+    size_t offset = at - aligned;
+    size_t count = min(sizeof(long) - offset, len - copied);
+    memcpy(dest + copied, reinterpret_cast<char *>(&word) + offset, count);
+    copied += count;
+  }
+  return copied;
+}
+
+size_t readTraceeMemory(pid_t pid, unsigned long addr, void *buffer, size_t len) {
+  static bool useVmReadv = true;
+  if (!useVmReadv) return peekTraceeMemory(pid, addr, buffer, len);
+
+  char *dest = static_cast<char *>(buffer);
+  size_t copied = 0;
+  while (copied < len) {
+    // one remote iovec per page, so an unmapped page ends the read there rather than failing all of it
+    struct iovec remote[kMaxIovecs];
+    size_t numIovecs = 0;
+    size_t requested = 0;
+    while (numIovecs < kMaxIovecs && copied + requested < len) {
+      unsigned long at = addr + copied + requested;
+      size_t count = min(bytesLeftInPage(at), len - copied - requested);
+      remote[numIovecs].iov_base = reinterpret_cast<void *>(at);
+      remote[numIovecs].iov_len = count;
+      numIovecs++;
+      requested += count;
+    }
+    struct iovec local = {dest + copied, requested};
+
+    ssize_t count = process_vm_readv(pid, &local, 1, remote, numIovecs, 0);
+    if (count == -1 && copied == 0 && (errno == ENOSYS || errno == EPERM)) {
+      useVmReadv = false;
+      return peekTraceeMemory(pid, addr, buffer, len);
+    }
+    if (count <= 0) break;
+    copied += count;
+    if (static_cast<size_t>(count) < requested) break;
+  }
+  return copied;
+}
+
+string readTraceeString(pid_t pid, unsigned long addr, size_t maxLen, bool& truncated) {
+  string str;
+  truncated = false;
+  vector<char> page(pageSize());
+  while (true) {
+    // one past maxLen, to see whether the terminator comes right after it
+    size_t wanted = min(bytesLeftInPage(addr) - 1, maxLen - str.size()) + 1;
+    size_t count = readTraceeMemory(pid, addr, page.data(), wanted);
+    const char *end = static_cast<const char *>(memchr(page.data(), '\0', count));
+    if (end != NULL) {
+      str.append(page.data(), end - page.data());
+      break;
+    }
+    str.append(page.data(), count);
+    if (count < wanted || str.size() >= maxLen) {
+      truncated = true;
+      str.resize(min(str.size(), maxLen));
+      break;
+    }
+    addr += count;
+  }
+  return str;
+}
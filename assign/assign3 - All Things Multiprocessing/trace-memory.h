@@ -0,0 +1,34 @@
+/**
+ * File: trace-memory.h
+ * --------------------
+ * Exports functions that copy strings and buffers out of a stopped tracee's
+ * address space.  Reads are made with process_vm_readv, which moves any
+ * number of bytes in a single system call, rather than with PTRACE_PEEKDATA,
+ * which needs one system call per eight-byte word.  If process_vm_readv isn't
+ * permitted (some sandboxes forbid it even for tracers), the functions quietly
+ * fall back to PTRACE_PEEKDATA.
+ */
+
+#pragma once
+#include <string>
+#include <sys/types.h>
+
+/**
+ * Function: readTraceeMemory
+ * --------------------------
+ * Copies up to len bytes starting at the tracee address addr into buffer,
+ * and returns how many were copied.  The remote range is split at page
+ * boundaries, so a read that runs into an unmapped page returns everything
+ * before that page instead of failing outright.
+ */
+size_t readTraceeMemory(pid_t pid, unsigned long addr, void *buffer, size_t len);
+
+/**
+ * Function: readTraceeString
+ * --------------------------
+ * Returns the NUL-terminated string at the tracee address addr, reading a
+ * page at a time (and never past the page holding the terminator).  At most
+ * maxLen characters are returned; if the string is longer than that, or runs
+ * into unreadable memory, truncated is set to true.
+ */
+std::string readTraceeString(pid_t pid, unsigned long addr, size_t maxLen, bool& truncated);
@@ -11,14 +11,63 @@ using namespace std;
 
 static const string kSimpleFlag = "--simple";
 static const string kRebuildFlag = "--rebuild";
-size_t processCommandLineFlags(bool& simple, bool& rebuild, char *argv[]) throw (TraceException) {  
+static const string kStringSizeFlag = "--strsize=";
+static const string kDumpSizeFlag = "--dump=";
+static const string kFilterFlag = "-e";
+static const string kSummaryFlag = "-c";
+static const string kCSVFlag = "--csv";
+static const string kFollowFlag = "-f";
+static const string kRecordFlag = "--record=";
+
+static size_t parseSize(const string& flag, const string& value) throw (TraceException) {
+  size_t end = 0;
+  unsigned long size = 0;
+  try {
+    size = stoul(value, &end);
+  } catch (const exception& e) {}
+  if (value.empty() || end != value.size() || value[0] == '-') {
+    throw TraceException("Expected a nonnegative integer after " + flag + " (got \"" + value + "\")");
+  }
+  return size;
+}
+
+static void parseFilter(const string& names, set<string>& filter) throw (TraceException) {
+  size_t start = 0;
+  while (start <= names.size()) {
+    size_t end = names.find(',', start);
+    if (end == string::npos) end = names.size();
+    string name = names.substr(start, end - start);
+    if (name.empty()) throw TraceException("Empty system call name in -e list (\"" + names + "\")");
+    filter.insert(name);
+    start = end + 1;
+  }
+}
+
+size_t processCommandLineFlags(traceOptions& options, char *argv[]) throw (TraceException) {
   size_t numFlags = 0;
-  for (int i = 1; argv[i] != NULL && startsWith(argv[i], "--"); i++) {
-    if (argv[i] == kSimpleFlag) simple = true;
-    else if (argv[i] == kRebuildFlag) rebuild = true;
+  for (int i = 1; argv[i] != NULL && startsWith(argv[i], "-"); i++) {
+    if (argv[i] == kSimpleFlag) options.simple = true;
+    else if (argv[i] == kRebuildFlag) options.rebuild = true;
+    else if (startsWith(argv[i], kStringSizeFlag)) options.stringSize = parseSize(kStringSizeFlag, argv[i] + kStringSizeFlag.size());
+    else if (startsWith(argv[i], kDumpSizeFlag)) options.dumpSize = parseSize(kDumpSizeFlag, argv[i] + kDumpSizeFlag.size());
+    else if (argv[i] == kSummaryFlag) options.summary = true;
+    else if (argv[i] == kCSVFlag) options.summary = options.csv = true;
+    else if (argv[i] == kFollowFlag) options.follow = true;
+    else if (startsWith(argv[i], kRecordFlag)) {
+      options.recordFile = argv[i] + kRecordFlag.size();
+      if (options.recordFile.empty()) throw TraceException(string(argv[0]) + ": " + kRecordFlag + " needs a file name");
+    }
+    else if (argv[i] == kFilterFlag) {
+      if (argv[i + 1] == NULL) throw TraceException(string(argv[0]) + ": " + kFilterFlag + " needs a list of system calls");
+      parseFilter(argv[++i], options.filter);
+      numFlags++;
+    }
     else throw TraceException(string(argv[0]) + ": Unrecognized flag (" + argv[i] + " )");
     numFlags++;
   }
-  
+
+  if (options.summary && !options.recordFile.empty()) {
+    throw TraceException(string(argv[0]) + ": -c can't be combined with " + kRecordFlag);
+  }
   return numFlags;
 }
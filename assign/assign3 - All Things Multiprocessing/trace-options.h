@@ -3,16 +3,82 @@
  * ---------------------
  * Exports a single function that knows how to process the command line invoking
  * trace.  The command line typically looks like the invocation of another executable, e.g.
- * something like "find /usr/include/ -name *.h -print" preceded by "trace", e.g. 
+ * something like "find /usr/include/ -name *.h -print" preceded by "trace", e.g.
  * "trace find /usr/include/ -name *.h -print".  However, trace itself can be fed one or two
  * flags, --simple and/or --rebuild.  The first one coaches trace to output a very simplified
  * version of trace, whereas the second one instructs trace to rebuild all of the prototypes
  * from scratch instead of relying on a cached file.
  *
+ * Two more flags take values: --strsize=<n> caps how many characters of each string
+ * argument are printed (by default they're printed in full), and --dump=<n> hex-dumps up to
+ * n bytes of the buffers passed to read, write and their relatives (by default nothing is
+ * dumped).
+ *
+ * Finally, -e <name>,<name>,... restricts tracing to the named system calls.  The tracee
+ * then runs under a seccomp filter that stops it only for those, so every other system
+ * call runs at full speed.  The processes and threads it creates inherit the filter, so
+ * trace follows them too, but without -f it reports none of their calls.
+ *
+ * -c prints no calls at all, just a table summarizing them (how many calls there were to
+ * each system call, how many failed, and how long they took) once the tracee exits.
+ * --csv prints that summary as comma-separated values instead.
+ *
+ * -f follows the tracee into every process and thread it creates (and they create), and
+ * prefixes each line with the id of the thread it's about.
+ *
+ * --record=<file> writes each system call to file as a binary record (see trace-record.h)
+ * instead of printing it, for trace-decode to print later.  It can't be combined with -c.
+ *
  * If the command line is malformed (e.g. bogus flags, etc), then a TraceException is thrown.
  */
 
 #pragma once
+#include <cstddef>
+#include <set>
+#include <string>
 #include "trace-exception.h"
 
-size_t processCommandLineFlags(bool& simple, bool& rebuild, char *argv[]) throw (TraceException);
+/**
+ * Constant: kUnlimitedStringSize
+ * ------------------------------
+ * The default string size limit, meaning none.
+ */
+static const size_t kUnlimitedStringSize = static_cast<size_t>(-1);
+
+/**
+ * Type: traceOptions
+ * ------------------
+ * Everything the command line can say about how trace should behave.
+ *
+ *  simple: print system call numbers and raw return values only (--simple)
+ *  rebuild: rebuild the system call signatures rather than using the cached ones (--rebuild)
+ *  stringSize: the most characters of a string argument to print (--strsize)
+ *  dumpSize: the most bytes of a read/write buffer to hex-dump, 0 for none (--dump)
+ *  filter: the names of the only system calls to trace, or empty to trace them all (-e)
+ *  summary: summarize the calls rather than printing them (-c)
+ *  csv: print the summary as comma-separated values (--csv, which implies -c)
+ *  follow: trace the tracee's child processes and threads as well (-f)
+ *  recordFile: the file to write binary records to, or empty to print calls as text (--record)
+ */
+struct traceOptions {
+  bool simple;
+  bool rebuild;
+  size_t stringSize;
+  size_t dumpSize;
+  std::set<std::string> filter;
+  bool summary;
+  bool csv;
+  bool follow;
+  std::string recordFile;
+
+  traceOptions(): simple(false), rebuild(false), stringSize(kUnlimitedStringSize), dumpSize(0),
+                  summary(false), csv(false), follow(false) {}
+};
+
+/**
+ * Function: processCommandLineFlags
+ * ---------------------------------
+ * Fills in options from the flags leading argv and returns how many of argv's
+ * entries they occupied.
+ */
+size_t processCommandLineFlags(traceOptions& options, char *argv[]) throw (TraceException);
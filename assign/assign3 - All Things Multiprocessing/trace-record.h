@@ -0,0 +1,54 @@
+/**
+ * File: trace-record.h
+ * --------------------
+ * Defines the binary trace-file format trace --record=<file> writes and trace-decode
+ * reads.  A trace file is a traceFileHeader followed by a sequence of traceRecords,
+ * each followed by payloadLength bytes of payload.  Every field is in the byte order
+ * of the machine that wrote it.
+ *
+ * An entry record holds the system call's raw argument registers, and its payload
+ * holds every string argument as trace read it out of the tracee: a traceString
+ * followed by length bytes (no terminating NUL).  An exit record's first value is the
+ * call's return value.  A no-return record says the thread vanished in mid-call.
+ * Records carry no text, so the tracer spends as little time on each call as it can;
+ * trace-decode supplies the names and does the formatting.
+ */
+
+#pragma once
+#include <cstdint>
+
+/**
+ * Constants: kTraceFileMagic, kTraceFileVersion
+ * ---------------------------------------------
+ * What every trace file starts with.
+ */
+static const char kTraceFileMagic[8] = {'C', 'S', '1', '1', '0', 'T', 'R', 'C'};
+static const uint32_t kTraceFileVersion = 1;
+
+struct traceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t follow;   // nonzero if the trace followed children (-f), so lines name their threads
+};
+
+enum traceRecordKind {
+  kRecordEntry = 1,
+  kRecordExit = 2,
+  kRecordNoReturn = 3
+};
+
+struct traceRecord {
+  uint32_t kind;          // a traceRecordKind
+  int32_t tid;
+  int64_t number;         // the system call number
+  int64_t timestamp;      // nanoseconds, from CLOCK_MONOTONIC
+  uint64_t values[6];     // the arguments (entry) or the return value (exit)
+  uint32_t payloadLength;
+  uint32_t unused;
+};
+
+struct traceString {
+  uint32_t argument;      // which argument the string was passed as
+  uint32_t length;
+  uint32_t truncated;     // nonzero if the string went on past length bytes
+};
@@ -0,0 +1,55 @@
+/**
+ * File: trace-seccomp.cc
+ * ----------------------
+ * Presents the implementation of installSeccompFilter.  The filter is one
+ * compare-and-return pair per selected system call, preceded by an
+ * architecture check (a 32-bit call would otherwise be matched against
+ * 64-bit numbers) and followed by a catch-all allow:
+ *
+ *        ld  arch
+ *        jeq AUDIT_ARCH_X86_64, 1, 0
+ *        ret ALLOW
+ *        ld  nr
+ *        jeq <nr 0>, 0, 1
+ *        ret TRACE
+ *        ...
+ *        ret ALLOW
+ */
+
+#include "trace-seccomp.h"
+#include <cstddef>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+using namespace std;
+
+static struct sock_filter statement(unsigned short code, unsigned int k) {
+  struct sock_filter instruction = BPF_STMT(code, k);
+  return instruction;
+}
+
+static struct sock_filter jump(unsigned short code, unsigned int k, unsigned char jt, unsigned char jf) {
+  struct sock_filter instruction = BPF_JUMP(code, k, jt, jf);
+  return instruction;
+}
+
+bool installSeccompFilter(const vector<int>& syscallNumbers) {
+  vector<struct sock_filter> program;
+  program.push_back(statement(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)));
+  program.push_back(jump(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0));
+  program.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+  program.push_back(statement(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)));
+  for (int number: syscallNumbers) {
+    program.push_back(jump(BPF_JMP | BPF_JEQ | BPF_K, static_cast<unsigned int>(number), 0, 1));
+    program.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_TRACE));
+  }
+  program.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+
+  struct sock_fprog fprog;
+  fprog.len = program.size();
+  fprog.filter = program.data();
+  // unprivileged processes may only install filters if they promise not to gain privileges
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1) return false;
+  return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &fprog) == 0;
+}
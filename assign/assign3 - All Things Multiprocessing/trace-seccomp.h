@@ -0,0 +1,22 @@
+/**
+ * File: trace-seccomp.h
+ * ---------------------
+ * Exports the function trace's child calls to restrict which of its system calls
+ * stop it for the tracer.
+ */
+
+#pragma once
+#include <vector>
+
+/**
+ * Function: installSeccompFilter
+ * ------------------------------
+ * Installs a seccomp-BPF filter on the calling process (and, across execvp,
+ * on the program it becomes) that answers SECCOMP_RET_TRACE for the system
+ * calls numbered in syscallNumbers and SECCOMP_RET_ALLOW for everything else.
+ * A tracer that set PTRACE_O_TRACESECCOMP and resumes with PTRACE_CONT then
+ * sees a PTRACE_EVENT_SECCOMP stop on entry to each selected call, and never
+ * hears about the rest.  Returns false (with errno set) if the filter couldn't
+ * be installed.
+ */
+bool installSeccompFilter(const std::vector<int>& syscallNumbers);
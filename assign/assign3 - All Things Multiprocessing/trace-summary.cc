@@ -0,0 +1,90 @@
+/**
+ * File: trace-summary.cc
+ * ----------------------
+ * Presents the implementation of the SystemCallSummary class.
+ */
+
+#include "trace-summary.h"
+#include <algorithm>
+#include <cstdio>
+using namespace std;
+
+void SystemCallSummary::record(long number, long returnValue, long long nanoseconds) {
+  stats& s = calls[number];
+  s.calls++;
+  if (returnValue < 0) s.errors++;
+  s.totalNanoseconds += nanoseconds;
+  s.nanoseconds.push_back(nanoseconds);
+}
+
+void SystemCallSummary::recordUnfinished(long number) {
+  calls[number].calls++;
+}
+
+/**
+ * Method: rows
+ * ------------
+ * Boils each system call's stats down to a row, sorted by total time (and then by
+ * call count, so calls too quick to time still come out in a sensible order).
+ */
+vector<SystemCallSummary::row> SystemCallSummary::rows(const map<int, string>& names) const {
+  vector<row> result;
+  for (const pair<const long, stats>& entry: calls) {
+    const stats& s = entry.second;
+    row r;
+    auto found = names.find(entry.first);
+    r.name = found != names.end() ? found->second : "syscall(" + to_string(entry.first) + ")";
+    r.calls = s.calls;
+    r.errors = s.errors;
+    r.totalSeconds = s.totalNanoseconds / 1e9;
+    r.meanMicroseconds = s.nanoseconds.empty() ? 0 : s.totalNanoseconds / 1e3 / s.nanoseconds.size();
+    r.p99Microseconds = 0;
+    if (!s.nanoseconds.empty()) {
+      vector<long long> sorted = s.nanoseconds;
+      size_t rank = (sorted.size() * 99 + 99) / 100 - 1; // ceil(0.99 * n) - 1
+      nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+      r.p99Microseconds = sorted[rank] / 1e3;
+    }
+    result.push_back(r);
+  }
+  sort(result.begin(), result.end(), [](const row& a, const row& b) {
+    return a.totalSeconds != b.totalSeconds ? a.totalSeconds > b.totalSeconds : a.calls > b.calls;
+  });
+  return result;
+}
+
+void SystemCallSummary::print(ostream& os, const map<int, string>& names) const {
+  vector<row> table = rows(names);
+  double totalSeconds = 0;
+  size_t totalCalls = 0, totalErrors = 0;
+  for (const row& r: table) {
+    totalSeconds += r.totalSeconds;
+    totalCalls += r.calls;
+    totalErrors += r.errors;
+  }
+
+  char line[256];
+  snprintf(line, sizeof(line), "%6s %11s %11s %11s %9s %9s %s", "% time", "seconds", "usecs/call", "p99 usecs", "calls", "errors", "syscall");
+  os << line << endl;
+  string rule = "------ ----------- ----------- ----------- --------- --------- ----------------";
+  os << rule << endl;
+  for (const row& r: table) {
+    double percent = totalSeconds > 0 ? 100 * r.totalSeconds / totalSeconds : 0;
+    snprintf(line, sizeof(line), "%6.2f %11.6f %11.2f %11.2f %9zu %9s %s", percent, r.totalSeconds,
+             r.meanMicroseconds, r.p99Microseconds, r.calls, r.errors > 0 ? to_string(r.errors).c_str() : "", r.name.c_str());
+    os << line << endl;
+  }
+  os << rule << endl;
+  snprintf(line, sizeof(line), "%6.2f %11.6f %11s %11s %9zu %9zu total", 100.0, totalSeconds, "", "", totalCalls, totalErrors);
+  os << line << endl;
+}
+
+void SystemCallSummary::printCSV(ostream& os, const map<int, string>& names) const {
+  os << "syscall,calls,errors,total_usecs,mean_usecs,p99_usecs" << endl;
+  char line[256];
+  for (const row& r: rows(names)) {
+    snprintf(line, sizeof(line), "%s,%zu,%zu,%.3f,%.3f,%.3f", r.name.c_str(), r.calls, r.errors,
+             r.totalSeconds * 1e6, r.meanMicroseconds, r.p99Microseconds);
+    os << line << endl;
+  }
+}
@@ -0,0 +1,71 @@
+/**
+ * File: trace-summary.h
+ * ---------------------
+ * Exports the class trace -c uses to aggregate system calls instead of
+ * printing them one by one.
+ */
+
+#pragma once
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class SystemCallSummary {
+ public:
+  /**
+   * Method: record
+   * --------------
+   * Notes one completed call to system call number, with the value it
+   * returned (negative values are counted as errors) and the nanoseconds
+   * that elapsed between its entry and exit stops.
+   */
+  void record(long number, long returnValue, long long nanoseconds);
+
+  /**
+   * Method: recordUnfinished
+   * ------------------------
+   * Notes a call that never returned (exit_group, say): it's counted, but
+   * contributes nothing to the timings.
+   */
+  void recordUnfinished(long number);
+
+  /**
+   * Method: print
+   * -------------
+   * Prints a table with one row per system call, busiest (by total time)
+   * first, then a row of totals.  Calls are named using names.
+   */
+  void print(std::ostream& os, const std::map<int, std::string>& names) const;
+
+  /**
+   * Method: printCSV
+   * ----------------
+   * Prints the same rows (without the totals) as comma-separated values,
+   * headed by a row of column names, with times in microseconds.
+   */
+  void printCSV(std::ostream& os, const std::map<int, std::string>& names) const;
+
+ private:
+  struct stats {
+    size_t calls;
+    size_t errors;
+    long long totalNanoseconds;
+    std::vector<long long> nanoseconds; // one per timed call, for the percentile
+
+    stats(): calls(0), errors(0), totalNanoseconds(0) {}
+  };
+
+  struct row {
+    std::string name;
+    size_t calls;
+    size_t errors;
+    double totalSeconds;
+    double meanMicroseconds;
+    double p99Microseconds;
+  };
+
+  std::map<long, stats> calls;
+
+  std::vector<row> rows(const std::map<int, std::string>& names) const;
+};
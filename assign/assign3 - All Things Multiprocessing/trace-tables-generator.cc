@@ -0,0 +1,100 @@
+/**
+ * File: trace-tables-generator.cc
+ * -------------------------------
+ * Runs the same system call and errno parsers trace used to run every time it started,
+ * and writes what they find out as the C++ source for the tables declared in
+ * trace-tables.h.  The Makefile runs this once to produce trace-tables.cc, so the
+ * parsing happens at build time instead.
+ *
+ *     ./trace-tables-generator trace-tables.cc
+ */
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include "trace-system-calls.h"
+#include "trace-error-constants.h"
+#include "trace-exception.h"
+#include "trace-tables.h"
+using namespace std;
+
+static void writeSystemCallTable(ostream& os, const map<int, string>& systemCallNumbers,
+                                 const map<string, systemCallSignature>& systemCallSignatures) {
+  int size = systemCallNumbers.empty() ? 0 : systemCallNumbers.rbegin()->first + 1;
+  os << "constexpr systemCallTableEntry kSystemCallTable[] = {" << endl;
+  for (int number = 0; number < size; number++) {
+    os << "  /* " << number << " */ ";
+    auto name = systemCallNumbers.find(number);
+    if (name == systemCallNumbers.end()) {
+      os << "{NULL, -1, {}}," << endl;
+      continue;
+    }
+
+    os << "{\"" << name->second << "\", ";
+    auto signature = systemCallSignatures.find(name->second);
+    if (signature == systemCallSignatures.end() || signature->second.size() > (size_t) kMaxSystemCallParams) {
+      os << "-1, {}}," << endl;
+      continue;
+    }
+
+    os << signature->second.size() << ", {";
+    for (size_t i = 0; i < signature->second.size(); i++) {
+      if (i > 0) os << ", ";
+      os << signature->second[i];
+    }
+    os << "}}," << endl;
+  }
+  os << "};" << endl;
+  os << "constexpr size_t kSystemCallTableSize = " << size << ";" << endl;
+}
+
+static void writeErrorNameTable(ostream& os, const map<int, string>& errorConstants) {
+  int size = errorConstants.empty() ? 0 : errorConstants.rbegin()->first + 1;
+  os << "constexpr const char *kErrorNameTable[] = {" << endl;
+  for (int value = 0; value < size; value++) {
+    auto found = errorConstants.find(value);
+    os << "  /* " << value << " */ ";
+    if (found == errorConstants.end()) os << "NULL," << endl;
+    else os << "\"" << found->second << "\"," << endl;
+  }
+  os << "};" << endl;
+  os << "constexpr size_t kErrorNameTableSize = " << size << ";" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    cerr << "Usage: " << argv[0] << " <output-file>" << endl;
+    return 1;
+  }
+
+  map<int, string> systemCallNumbers;
+  map<string, int> systemCallNames;
+  map<string, systemCallSignature> systemCallSignatures;
+  map<int, string> errorConstants;
+  compileSystemCallData(systemCallNumbers, systemCallNames, systemCallSignatures, false);
+  try {
+    compileSystemCallErrorStrings(errorConstants);
+  } catch (const MissingFileException& me) {
+    cerr << me.what() << endl;
+    return 1;
+  }
+
+  ofstream out(argv[1]);
+  if (!out) {
+    cerr << "Couldn't open \"" << argv[1] << "\" for writing." << endl;
+    return 1;
+  }
+
+  out << "/**" << endl
+      << " * File: trace-tables.cc" << endl
+      << " * ---------------------" << endl
+      << " * Generated by trace-tables-generator.  Don't edit this file: edit (or rerun) the" << endl
+      << " * generator instead." << endl
+      << " */" << endl << endl
+      << "#include \"trace-tables.h\"" << endl << endl;
+  writeSystemCallTable(out, systemCallNumbers, systemCallSignatures);
+  out << endl;
+  writeErrorNameTable(out, errorConstants);
+  return out ? 0 : 1;
+}
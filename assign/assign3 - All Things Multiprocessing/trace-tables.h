@@ -0,0 +1,51 @@
+/**
+ * File: trace-tables.h
+ * --------------------
+ * Declares the system call and errno tables trace-tables-generator compiles into trace,
+ * so that trace can name system calls, decode their arguments, and name error codes
+ * without parsing a single header (or the signature cache) at startup.  The tables
+ * themselves live in trace-tables.cc, which the Makefile generates by running
+ * trace-tables-generator, which in turn gets everything from compileSystemCallData
+ * and compileSystemCallErrorStrings.
+ */
+
+#pragma once
+#include <cstddef>
+#include "trace-system-calls.h"
+
+/**
+ * Constant: kMaxSystemCallParams
+ * ------------------------------
+ * No system call takes more than six arguments, since that's how many registers
+ * the x86_64 calling convention sets aside for them.
+ */
+static const int kMaxSystemCallParams = 6;
+
+/**
+ * Type: systemCallTableEntry
+ * --------------------------
+ * Everything known about one system call number: its name (or NULL if nothing's
+ * assigned that number), and its signature, which is numParams entries of params.
+ * numParams is -1 if the call has a name but no known signature.
+ */
+struct systemCallTableEntry {
+  const char *name;
+  int numParams;
+  scParamType params[kMaxSystemCallParams];
+};
+
+/**
+ * Constants: kSystemCallTable, kSystemCallTableSize
+ * -------------------------------------------------
+ * Indexed by system call number.
+ */
+extern const systemCallTableEntry kSystemCallTable[];
+extern const size_t kSystemCallTableSize;
+
+/**
+ * Constants: kErrorNameTable, kErrorNameTableSize
+ * -----------------------------------------------
+ * Indexed by errno value, with NULL for values no constant is #defined to.
+ */
+extern const char *const kErrorNameTable[];
+extern const size_t kErrorNameTableSize;
@@ -0,0 +1,120 @@
+/**
+ * File: trace-writer.cc
+ * ---------------------
+ * Presents the implementation of the TraceWriter class.  The writer thread drains
+ * whatever's queued, then naps for a millisecond so the next batch has time to
+ * accumulate; a producer that finds the ring buffer full wakes it early.
+ */
+
+#include "trace-writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+using namespace std;
+
+static const chrono::milliseconds kNap(1);
+
+TraceWriter::TraceWriter(int fd, size_t capacity):
+  fd(fd), ring(capacity), head(0), tail(0), done(false), buffer(*this), writer(&TraceWriter::drain, this) {}
+
+TraceWriter::~TraceWriter() {
+  buffer.pubsync();
+  done = true;
+  idle.notify_one();
+  writer.join();
+}
+
+void TraceWriter::write(const void *data, size_t len) {
+  const char *bytes = static_cast<const char *>(data);
+  size_t mask = ring.size() - 1;
+  while (len > 0) {
+    size_t end = tail.load(memory_order_relaxed);
+    size_t room = ring.size() - (end - head.load(memory_order_acquire));
+    if (room == 0) {
+      idle.notify_one();
+      this_thread::yield();
+      continue;
+    }
+
+    size_t count = min(len, room);
+    size_t first = min(count, ring.size() - (end & mask)); // the rest wraps around to the front
+    memcpy(&ring[end & mask], bytes, first);
+    memcpy(&ring[0], bytes + first, count - first);
+    tail.store(end + count, memory_order_release);
+    bytes += count;
+    len -= count;
+  }
+}
+
+void TraceWriter::flush() {
+  buffer.pubsync();
+  while (head.load(memory_order_acquire) != tail.load(memory_order_acquire)) {
+    idle.notify_one();
+    this_thread::yield();
+  }
+}
+
+/**
+ * Method: drain
+ * -------------
+ * The writer thread's routine.  It's the only one that advances head, and only
+ * once the bytes it's moving past have been written, so a producer never
+ * overwrites anything still in flight.
+ */
+void TraceWriter::drain() {
+  size_t mask = ring.size() - 1;
+  while (true) {
+    bool finishing = done; // read before tail, so nothing queued before done was set is missed
+    size_t start = head.load(memory_order_relaxed);
+    size_t end = tail.load(memory_order_acquire);
+    if (start == end) {
+      if (finishing) return;
+      unique_lock<mutex> lock(m);
+      idle.wait_for(lock, kNap);
+      continue;
+    }
+
+    size_t first = min(end - start, ring.size() - (start & mask));
+    writeAll(&ring[start & mask], first);
+    writeAll(&ring[0], end - start - first);
+    head.store(end, memory_order_release);
+  }
+}
+
+/**
+ * Method: writeAll
+ * ----------------
+ * Writes all len bytes to fd, or as many as fd will take: if it stops taking
+ * them (the reader at the other end of a pipe has gone, say), the rest are
+ * dropped rather than left to fill the ring buffer and stall the tracer.
+ */
+void TraceWriter::writeAll(const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t count = ::write(fd, data, len);
+    if (count == -1 && errno == EINTR) continue;
+    if (count <= 0) return;
+    data += count;
+    len -= count;
+  }
+}
+
+TraceWriter::ostreambuf::ostreambuf(TraceWriter& writer): writer(writer) {
+  setp(pending, pending + sizeof(pending));
+}
+
+TraceWriter::ostreambuf::int_type TraceWriter::ostreambuf::overflow(int_type ch) {
+  sync();
+  if (ch != traits_type::eof()) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+int TraceWriter::ostreambuf::sync() {
+  writer.write(pbase(), pptr() - pbase());
+  setp(pending, pending + sizeof(pending));
+  return 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * File: trace-writer.h
+ * --------------------
+ * Exports the TraceWriter class, which takes trace's output off the tracing loop's
+ * hands.  Whatever's handed to a TraceWriter is copied into a ring buffer, and a
+ * thread of its own drains that buffer into a file descriptor in batches, so
+ * the loop never waits on a write system call (let alone two per traced call,
+ * as it did when every line ended with a flushing endl).
+ *
+ * The ring buffer is lock-free: exactly one thread (the tracing loop) writes
+ * into it and exactly one (the writer thread) reads out of it, and each only
+ * ever advances its own index.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+class TraceWriter {
+ public:
+  /**
+   * Constant: kDefaultCapacity
+   * --------------------------
+   * The default ring buffer size, in bytes.  Must be a power of two.
+   */
+  static const size_t kDefaultCapacity = 1 << 20;
+
+  /**
+   * Constructor: TraceWriter
+   * ------------------------
+   * Starts a writer thread that copies everything handed to this TraceWriter
+   * to fd, which the TraceWriter does not own (so doesn't close).
+   */
+  TraceWriter(int fd, size_t capacity = kDefaultCapacity);
+
+  /**
+   * Destructor: ~TraceWriter
+   * ------------------------
+   * Waits for everything written so far to reach fd, then stops the writer thread.
+   */
+  ~TraceWriter();
+
+  /**
+   * Method: write
+   * -------------
+   * Queues len bytes for the writer thread, waiting (only) if the ring buffer
+   * hasn't room for them yet.  Must always be called from the same thread.
+   */
+  void write(const void *data, size_t len);
+
+  /**
+   * Method: flush
+   * -------------
+   * Waits until everything written so far has been handed to fd.
+   */
+  void flush();
+
+  /**
+   * Method: streambuf
+   * -----------------
+   * Returns a stream buffer that feeds this TraceWriter, so an ostream (cout,
+   * say, via cout.rdbuf) can be pointed at it.  Flushing that ostream (endl,
+   * say) only queues what's been formatted; it never waits on the descriptor.
+   */
+  std::streambuf *streambuf() { return &buffer; }
+
+ private:
+  class ostreambuf: public std::streambuf {
+   public:
+    ostreambuf(TraceWriter& writer);
+
+   protected:
+    int_type overflow(int_type ch);
+    int sync();
+
+   private:
+    TraceWriter& writer;
+    char pending[4096];
+  };
+
+  int fd;
+  std::vector<char> ring;
+  std::atomic<size_t> head; // total bytes written to fd, advanced only by the writer thread
+  std::atomic<size_t> tail; // total bytes queued, advanced only by write
+  std::atomic<bool> done;
+  std::mutex m;             // only for sleeping on idle, never held while copying
+  std::condition_variable idle;
+  ostreambuf buffer;
+  std::thread writer;
+
+  void drain();
+  void writeAll(const char *data, size_t len);
+
+  TraceWriter(const TraceWriter& original) = delete;
+  TraceWriter& operator=(const TraceWriter& rhs) = delete;
+};
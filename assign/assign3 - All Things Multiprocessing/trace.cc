@@ -10,53 +10,180 @@
  *    + the system calls return value
  */
 #include <climits>
+#include <algorithm>
+#include <cerrno>
+#include <cctype>
+#include <cstdio>
 #include <cassert>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h> // for open
 #include <unistd.h> // for fork, execvp
 #include <string.h> // for memchr, strerror
+#include <time.h> // for clock_gettime
 #include <sys/ptrace.h>
 #include <sys/reg.h>
+#include <sys/user.h> // for user_regs_struct
 #include <sys/wait.h>
 #include "string-utils.h"
 #include "trace-options.h"
 #include "trace-error-constants.h"
 #include "trace-system-calls.h"
+#include "trace-memory.h"
+#include "trace-seccomp.h"
+#include "trace-summary.h"
+#include "trace-tables.h"
+#include "trace-writer.h"
+#include "trace-record.h"
 #include "trace-exception.h"
 using namespace std;
 
 static std::map<int, std::string> systemCallNumbers;
 static std::map<std::string, int> systemCallNames;
 static std::map<std::string, systemCallSignature> systemCallSignatures;
-static std::map<int, int> registerNumbers = {{0, RDI}, {1, RSI}, {2, RDX}, {3, R10}, {4, R8}, {5, R9}};
 static std::map<int, std::string> errorConstants;
 
-static string readString(pid_t pid, unsigned long addr) { // addr is a char * read from an argument register  
-	string str; // start out empty
-	size_t numBytesRead = 0;
-	bool isEndOfStr = false;
-	while (!isEndOfStr) {
-		long ret = ptrace(PTRACE_PEEKDATA, pid, addr + numBytesRead);
-		const char* word = reinterpret_cast<const char *> (&ret);
-		for(unsigned int i = 0; i < sizeof(long); i++) {
-			char ch = *(word + i);
-			if(ch == '\0') {
-				isEndOfStr = true;
-				break;
-			}
-			str.push_back(ch);
+/**
+ * The buffer arguments worth dumping: which argument holds the buffer, and whether
+ * it's filled in by the call (so can only be dumped once it returns, with the return
+ * value as its length) or supplied to it (dumped on entry, with the next argument as
+ * its length).
+ */
+struct bufferArgument {
+	int index;
+	bool filledByCall;
+};
+static const std::map<std::string, bufferArgument> kBufferArguments = {
+	{"read", {1, true}}, {"pread64", {1, true}}, {"recvfrom", {1, true}},
+	{"write", {1, false}}, {"pwrite64", {1, false}}, {"sendto", {1, false}}
+};
+
+/**
+ * The maps above, flattened into arrays indexed by system call number, so that each
+ * stop costs an index rather than a string lookup or two.  Built by flattenMaps.
+ */
+static std::vector<std::string> namesByNumber;
+static std::vector<systemCallSignature> signaturesByNumber;
+static std::vector<const bufferArgument *> buffersByNumber;
+
+/**
+ * The registers holding a system call's arguments, in order.
+ */
+static unsigned long long user_regs_struct::*const kArgumentRegisters[] = {
+	&user_regs_struct::rdi, &user_regs_struct::rsi, &user_regs_struct::rdx,
+	&user_regs_struct::r10, &user_regs_struct::r8, &user_regs_struct::r9
+};
+
+static unsigned long argument(const user_regs_struct& regs, unsigned int i) {
+	return regs.*kArgumentRegisters[i];
+}
+
+/**
+ * Everything leaveSysCall needs to know about the buffer (if any) enterSysCall
+ * decided should be dumped.
+ */
+struct pendingDump {
+	bool active;
+	bool filledByCall;
+	unsigned long addr;
+	size_t len;
+};
+
+static traceOptions options;
+
+/**
+ * Everything trace needs to remember about one traced thread between stops:
+ * whether it's inside a system call (and which, and since when), whether it's
+ * a newly attached thread whose initial SIGSTOP is still to come, and any
+ * buffer waiting to be dumped when its call returns.
+ */
+struct tracee {
+	bool inSysCall;
+	bool expectingStop;
+	bool silent;		// followed only to keep it running under -e's filter (see traceAll), never reported
+	long number;
+	long long start;
+	pendingDump dump;
+};
+static unordered_map<pid_t, tracee> tracees;
+static pid_t tracedPid = 0;	// the process trace started
+static SystemCallSummary summary;
+
+/**
+ * Where binary records go under --record, or NULL if calls are printed as text.
+ */
+static TraceWriter *recorder = NULL;
+
+/**
+ * The thread whose system call's entry has been printed but whose "= ..." hasn't,
+ * or 0 if the last line printed is complete.
+ */
+static pid_t unfinished = 0;
+
+static long long nowNanoseconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static string readString(pid_t pid, unsigned long addr, size_t maxLen) { // addr is a char * read from an argument register
+	bool truncated;
+	string str = readTraceeString(pid, addr, maxLen, truncated);
+	return "\"" + str + (truncated ? "\"..." : "\"");
+}
+
+/**
+ * Function: dumpBuffer
+ * --------------------
+ * Prints up to options.dumpSize bytes of the tracee buffer at addr, sixteen to a line,
+ * in hex and then as characters.
+ */
+static void dumpBuffer(pid_t pid, unsigned long addr, size_t len) {
+	static const size_t kBytesPerLine = 16;
+	vector<unsigned char> buffer(min(len, options.dumpSize));
+	size_t count = readTraceeMemory(pid, addr, buffer.data(), buffer.size());
+	char line[128];
+	for(size_t offset = 0; offset < count; offset += kBytesPerLine) {
+		int pos = snprintf(line, sizeof(line), " | %05zx ", offset);
+		for(size_t i = offset; i < offset + kBytesPerLine; i++) {
+			pos += i < count ? snprintf(line + pos, sizeof(line) - pos, " %02x", buffer[i]) : snprintf(line + pos, sizeof(line) - pos, "   ");
 		}
-		numBytesRead += sizeof(long); 
-		// the following conditiong is used for debug
-		if(numBytesRead > 100) {
-			break;
+		pos += snprintf(line + pos, sizeof(line) - pos, "  ");
+		for(size_t i = offset; i < offset + kBytesPerLine; i++) {
+			line[pos++] = i >= count ? ' ' : isprint(buffer[i]) ? buffer[i] : '.';
 		}
+		snprintf(line + pos, sizeof(line) - pos, " |");
+		cout << line << endl;
+	}
+	if(count < len) {
+		cout << " | ... " << len - count << " more bytes" << (count < buffer.size() ? " (unreadable)" : "") << endl;
 	}
-	return str;
 }
 
-void readRegister(pid_t pid, vector<enum scParamType> sysCallSig, map<int, int> registerNumbers) {
+/**
+ * Function: stringLimit
+ * ---------------------
+ * The most characters of argument i to print.  The buffers handed to write and
+ * friends are typed as strings but needn't be NUL-terminated, so they're cut off
+ * at the length passed alongside them.
+ */
+static size_t stringLimit(const user_regs_struct& regs, const bufferArgument *buffer, unsigned int i) {
+	if(buffer == NULL || buffer->filledByCall || buffer->index != (int) i) {
+		return options.stringSize;
+	}
+	size_t len = argument(regs, i + 1);
+	return min(len, options.stringSize);
+}
+
+void readRegister(pid_t pid, long sysCallNum, const user_regs_struct& regs) {
+	static const systemCallSignature kNoSignature;
+	bool known = sysCallNum >= 0 && sysCallNum < (long) signaturesByNumber.size();
+	const systemCallSignature& sysCallSig = known ? signaturesByNumber[sysCallNum] : kNoSignature;
+	const bufferArgument *buffer = known ? buffersByNumber[sysCallNum] : NULL;
 	cout << "(";
 	if(sysCallSig.size() == 0) cout << "<signature-information-missing>";
 	for(unsigned int i = 0; i < sysCallSig.size(); i++) {
@@ -64,19 +191,17 @@ void readRegister(pid_t pid, vector<enum scParamType> sysCallSig, map<int, int>
 		switch(sc) {
 			case SYSCALL_INTEGER: 
 				{
-					cout << ptrace(PTRACE_PEEKUSER, pid, registerNumbers[i] * sizeof(long));
+					cout << (long) argument(regs, i);
 					break;
 				}
 			case SYSCALL_STRING: 
 				{
-					unsigned long addr = ptrace(PTRACE_PEEKUSER, pid, registerNumbers[i] * sizeof(long));
-					string str = readString(pid, addr);
-					cout << "\"" << str << "\"";
+					cout << readString(pid, argument(regs, i), stringLimit(regs, buffer, i));
 					break;
 				}
 			case SYSCALL_POINTER: 
 				{
-					long addr = ptrace(PTRACE_PEEKUSER, pid, registerNumbers[i] * sizeof(long));
+					long addr = argument(regs, i);
 					if(addr == 0) {
 						cout << "NULL";
 					} else {
@@ -96,7 +221,48 @@ void readRegister(pid_t pid, vector<enum scParamType> sysCallSig, map<int, int>
 	cout << ") ";
 }
 
+/**
+ * Fills the maps from the tables compiled into trace, which is all trace needs to
+ * do at startup unless asked to --rebuild them by parsing the system headers.
+ */
+void loadCompiledTables() {
+	for(size_t number = 0; number < kSystemCallTableSize; number++) {
+		const systemCallTableEntry& entry = kSystemCallTable[number];
+		if(entry.name == NULL) continue;
+		systemCallNumbers[number] = entry.name;
+		systemCallNames[entry.name] = number;
+		if(entry.numParams >= 0) {
+			systemCallSignatures[entry.name] = systemCallSignature(entry.params, entry.params + entry.numParams);
+		}
+	}
+	for(size_t value = 0; value < kErrorNameTableSize; value++) {
+		if(kErrorNameTable[value] != NULL) errorConstants[value] = kErrorNameTable[value];
+	}
+}
+
+/**
+ * Copies what the maps know into the per-number arrays the tracing loop uses.
+ */
+void flattenMaps() {
+	size_t size = systemCallNumbers.empty() ? 0 : systemCallNumbers.rbegin()->first + 1;
+	namesByNumber.assign(size, "");
+	signaturesByNumber.assign(size, systemCallSignature());
+	buffersByNumber.assign(size, NULL);
+	for(const pair<const int, string>& entry: systemCallNumbers) {
+		if(entry.first < 0) continue;
+		namesByNumber[entry.first] = entry.second;
+		auto signature = systemCallSignatures.find(entry.second);
+		if(signature != systemCallSignatures.end()) signaturesByNumber[entry.first] = signature->second;
+		auto buffer = kBufferArguments.find(entry.second);
+		if(buffer != kBufferArguments.end()) buffersByNumber[entry.first] = &buffer->second;
+	}
+}
+
 void compileMaps(bool rebuild) {
+	if(!rebuild) {
+		loadCompiledTables();
+		return;
+	}
 	compileSystemCallData(systemCallNumbers, systemCallNames, systemCallSignatures, rebuild);
 	try {
 		compileSystemCallErrorStrings(errorConstants);
@@ -109,24 +275,137 @@ void compileMaps(bool rebuild) {
 	}
 }
 
-void enterSysCall(pid_t pid, bool simple, int& exitNumber) {
-	long sysCallNum = ptrace(PTRACE_PEEKUSER, pid, ORIG_RAX * sizeof(long));
-	if(simple) {
+static void prepareDump(long sysCallNum, const user_regs_struct& regs, pendingDump& dump) {
+	dump.active = false;
+	if(options.dumpSize == 0) return;
+	if(sysCallNum < 0 || sysCallNum >= (long) buffersByNumber.size()) return;
+	const bufferArgument *arg = buffersByNumber[sysCallNum];
+	if(arg == NULL) return;
+	dump.active = true;
+	dump.filledByCall = arg->filledByCall;
+	dump.addr = argument(regs, arg->index);
+	dump.len = argument(regs, arg->index + 1);
+}
+
+static string sysCallName(long number) {
+	if(options.simple) return "syscall(" + to_string(number) + ")";
+	return number >= 0 && number < (long) namesByNumber.size() ? namesByNumber[number] : "";
+}
+
+/**
+ * Function: finishLine
+ * --------------------
+ * Marks the entry line some other thread left open as unfinished, so the
+ * next thing printed starts on a line of its own.
+ */
+static void finishLine() {
+	if(unfinished == 0) return;
+	cout << "<unfinished ...>" << endl;
+	unfinished = 0;
+}
+
+static void startLine(pid_t tid) {
+	finishLine();
+	if(options.follow) cout << "[" << tid << "] ";
+}
+
+/**
+ * Function: resumeLine
+ * --------------------
+ * Readies the output for the result of tid's current system call: that's the
+ * rest of the current line if that line is its entry, or else a new line
+ * recalling which call is being resumed.
+ */
+static void resumeLine(pid_t tid, const tracee& t) {
+	if(unfinished != tid) {
+		startLine(tid);
+		cout << "<... " << sysCallName(t.number) << " resumed> ";
+	}
+	unfinished = 0;
+}
+
+/**
+ * Function: recordEntry
+ * ---------------------
+ * Writes an entry record for the system call pid is entering, followed by each
+ * of its string arguments, read out of pid now while they're still there.
+ */
+static void recordEntry(pid_t pid, long sysCallNum, const user_regs_struct& regs) {
+	traceRecord record = traceRecord();
+	record.kind = kRecordEntry;
+	record.tid = pid;
+	record.number = sysCallNum;
+	record.timestamp = nowNanoseconds();
+	for(int i = 0; i < kMaxSystemCallParams; i++) record.values[i] = argument(regs, i);
+	string payload;
+	if(sysCallNum >= 0 && sysCallNum < (long) signaturesByNumber.size()) {
+		const systemCallSignature& sysCallSig = signaturesByNumber[sysCallNum];
+		for(unsigned int i = 0; i < sysCallSig.size(); i++) {
+			if(sysCallSig[i] != SYSCALL_STRING) continue;
+			traceString header;
+			bool truncated;
+			string str = readTraceeString(pid, argument(regs, i), stringLimit(regs, buffersByNumber[sysCallNum], i), truncated);
+			header.argument = i;
+			header.length = str.size();
+			header.truncated = truncated;
+			payload.append(reinterpret_cast<const char *>(&header), sizeof(header));
+			payload += str;
+		}
+	}
+	record.payloadLength = payload.size();
+	recorder->write(&record, sizeof(record));
+	recorder->write(payload.data(), payload.size());
+}
+
+static void recordResult(pid_t pid, traceRecordKind kind, long number, long returnValue) {
+	traceRecord record = traceRecord();
+	record.kind = kind;
+	record.tid = pid;
+	record.number = number;
+	record.timestamp = nowNanoseconds();
+	record.values[0] = returnValue;
+	recorder->write(&record, sizeof(record));
+}
+
+void enterSysCall(pid_t pid, tracee& t) {
+	struct user_regs_struct regs; // one snapshot of every register, rather than a PTRACE_PEEKUSER per register
+	ptrace(PTRACE_GETREGS, pid, 0, &regs);
+	long sysCallNum = regs.orig_rax;
+	t.number = sysCallNum;
+	t.inSysCall = true;
+	if(options.summary) {
+		t.start = nowNanoseconds(); // last, so reading registers isn't charged to the call
+		return;
+	}
+	if(recorder != NULL) {
+		recordEntry(pid, sysCallNum, regs);
+		return;
+	}
+	startLine(pid);
+	if(options.simple) {
 		cout << "syscall(" << sysCallNum << ") ";
 	} else {
-		string sysCallName = systemCallNumbers[sysCallNum];
-		cout << sysCallName;
-		vector<scParamType> sysCallSig = systemCallSignatures[sysCallName];
-		readRegister(pid, sysCallSig, registerNumbers);
-		if(sysCallNum == systemCallNames["exit_group"]) {
-			exitNumber = ptrace(PTRACE_PEEKUSER, pid, RDI * sizeof(long));
-		}
+		cout << sysCallName(sysCallNum);
+		readRegister(pid, sysCallNum, regs);
+		prepareDump(sysCallNum, regs, t.dump);
 	}
+	unfinished = pid;
 }
 
-void leaveSysCall(pid_t pid, bool simple) {
+void leaveSysCall(pid_t pid, tracee& t) {
+	long long elapsed = nowNanoseconds() - t.start;
+	t.inSysCall = false;
 	long returnValue = ptrace(PTRACE_PEEKUSER, pid, RAX * sizeof(long));
-	if(simple) {
+	if(options.summary) {
+		summary.record(t.number, returnValue, elapsed);
+		return;
+	}
+	if(recorder != NULL) {
+		recordResult(pid, kRecordExit, t.number, returnValue);
+		return;
+	}
+	resumeLine(pid, t);
+	if(options.simple) {
 		cout << "= " << returnValue; 
 	} else {
 		cout << "= ";
@@ -143,69 +422,244 @@ void leaveSysCall(pid_t pid, bool simple) {
 		}
 	}
 	cout << endl;
+	if(!options.simple && t.dump.active) {
+		// a filled-in buffer only holds as many bytes as the call returned
+		size_t len = !t.dump.filledByCall ? t.dump.len : returnValue > 0 ? returnValue : 0;
+		dumpBuffer(pid, t.dump.addr, len);
+		t.dump.active = false;
+	}
+}
+
+/**
+ * Function: retireTracee
+ * ----------------------
+ * Called once a thread is gone.  If it went in the middle of a system call
+ * (exit_group, usually), that call is reported as never returning.
+ */
+static void retireTracee(pid_t tid, const tracee& t) {
+	if(!t.inSysCall) return;
+	if(options.summary) {
+		summary.recordUnfinished(t.number);
+		return;
+	}
+	if(recorder != NULL) {
+		recordResult(tid, kRecordNoReturn, t.number, 0);
+		return;
+	}
+	resumeLine(tid, t);
+	cout << "= <no return>" << endl;
+}
+
+/**
+ * Function: isGroupStop
+ * ---------------------
+ * Without PTRACE_SEIZE, a tracee stopping because of a stop signal it's
+ * already been handed reports exactly like a fresh SIGSTOP.  Only the
+ * fresh one has siginfo, and only it should be passed back.
+ */
+static bool isGroupStop(pid_t tid, int signal) {
+	if(signal != SIGSTOP && signal != SIGTSTP && signal != SIGTTIN && signal != SIGTTOU) return false;
+	siginfo_t info;
+	return ptrace(PTRACE_GETSIGINFO, tid, 0, &info) == -1;
+}
+
+/**
+ * Function: addTracee
+ * -------------------
+ * Starts keeping state for a thread trace has just learned of, which is
+ * silent unless -f was given or it's the thread trace started with.
+ */
+static tracee& addTracee(pid_t tid) {
+	tracee& t = tracees[tid];
+	t.expectingStop = tid != tracedPid;
+	t.silent = !options.follow && tid != tracedPid;
+	return t;
+}
+
+/**
+ * Function: handleEvent
+ * ---------------------
+ * Handles a ptrace event stop (status >> 16 nonzero).  Every fork, vfork and
+ * clone (with -f or -e) reports the new thread's id, and the thread is traced
+ * from its first instruction.  An exec reports the id the execing thread had
+ * before it took over the thread group leader's, so its state can follow it.
+ */
+static void handleEvent(pid_t tid, int event) {
+	unsigned long message = 0;
+	ptrace(PTRACE_GETEVENTMSG, tid, 0, &message);
+	pid_t other = message;
+	if(event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+		// the new thread's first stop may have been seen (and the thread added) already
+		if(tracees.count(other) == 0) addTracee(other);
+	} else if(event == PTRACE_EVENT_EXEC && other != tid && tracees.count(other) > 0) {
+		tracees[tid] = tracees[other];
+		tracees[tid].silent = !options.follow && tid != tracedPid;
+		tracees.erase(other);
+		if(unfinished == other) finishLine();
+	} else if(event == PTRACE_EVENT_SECCOMP && !tracees[tid].silent) {
+		enterSysCall(tid, tracees[tid]);
+	}
 }
 
-void detectSysCall(pid_t pid, bool simple) {
-	int exitNumber = 0;
-	while(true) {
-		// when it enters a system call
-		int status1;
-		waitpid(pid, &status1, 0); 
-		if(WIFEXITED(status1) || WIFSIGNALED(status1)) {
+/**
+ * Function: traceAll
+ * ------------------
+ * The event loop: collects every stop of every traced thread with a single
+ * waitpid(-1, ..., __WALL), keeping each thread's entry/exit state in tracees,
+ * and returns the wait status of the original tracee once all of them are gone.
+ *
+ * Without -e, threads are resumed with PTRACE_SYSCALL, so each system call
+ * stops the thread on its way in and again on its way out.  With -e, the
+ * seccomp filter stops a thread (with a PTRACE_EVENT_SECCOMP stop) only on
+ * entry to the selected calls; each of those is followed to its exit with
+ * a single PTRACE_SYSCALL, after which the thread runs under PTRACE_CONT.
+ * Ordinary signals are passed along either way.
+ *
+ * The filter is inherited by every process and thread the tracee creates, and
+ * the kernel fails each call it selects with ENOSYS in a thread nobody traces.
+ * So with -e, those threads are always traced, even without -f.  Without it,
+ * they're silent: each of their seccomp stops is resumed with PTRACE_CONT and
+ * nothing is reported.  They can't be detached, since that would leave them
+ * untraced, so trace waits for them to finish too.
+ */
+static int traceAll(pid_t pid) {
+	bool filtered = !options.filter.empty();
+	int pidStatus = 0;
+	tracedPid = pid;
+	addTracee(pid);
+	while(!tracees.empty()) {
+		int status;
+		pid_t tid = waitpid(-1, &status, __WALL);
+		if(tid == -1) {
+			if(errno == EINTR) continue;
 			break;
 		}
-		if(WIFSTOPPED(status1)) {
-			if(WSTOPSIG(status1) == (SIGTRAP|0x80)) {
-				enterSysCall(pid, simple, exitNumber);
-				ptrace(PTRACE_SYSCALL, pid, 0, 0);
-				// when it leaves a system call
-				int status2;
-				waitpid(pid, &status2, WUNTRACED); 
-				ptrace(PTRACE_SETOPTIONS, pid, 0, PTRACE_O_TRACESYSGOOD);
-				if(WIFEXITED(status2) || WIFSIGNALED(status2)) {
-					break;
-				}
-				if(WIFSTOPPED(status2)) {
-					if(WSTOPSIG(status2) == (SIGTRAP|0x80)) {
-						leaveSysCall(pid, simple);
-					} 
-					ptrace(PTRACE_SYSCALL, pid, 0, 0);
-				}
-			} 
-			ptrace(PTRACE_SYSCALL, pid, 0, 0);
+		if(WIFEXITED(status) || WIFSIGNALED(status)) {
+			auto found = tracees.find(tid);
+			if(found != tracees.end()) {
+				retireTracee(tid, found->second);
+				tracees.erase(found);
+			}
+			if(tid == pid) pidStatus = status;
+			continue;
+		}
+		if(!WIFSTOPPED(status)) continue;
+
+		if(tracees.count(tid) == 0) addTracee(tid); // beat its parent's clone event here
+		int signal = 0;
+		int event = status >> 16;
+		if(event != 0) {
+			handleEvent(tid, event);
+		} else if(WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+			tracee& t = tracees[tid];
+			if(t.inSysCall) {
+				leaveSysCall(tid, t);
+			} else if(!filtered) {
+				enterSysCall(tid, t);
+			}
+		} else if(WSTOPSIG(status) == SIGSTOP && tracees[tid].expectingStop) {
+			tracees[tid].expectingStop = false; // the stop every newly attached thread starts with
+		} else if(!isGroupStop(tid, WSTOPSIG(status))) {
+			signal = WSTOPSIG(status);
 		}
+		bool stopAtExit = !filtered || tracees[tid].inSysCall;
+		ptrace(stopAtExit ? PTRACE_SYSCALL : PTRACE_CONT, tid, 0, signal);
 	}
-	// end of output
-	cout << "= <no return>" << endl;
-	cout << "Program exited normally with status " << exitNumber << endl;
+	finishLine();
+	return pidStatus;
+}
+
+/**
+ * Function: filteredSysCallNumbers
+ * --------------------------------
+ * Translates the names given to -e into system call numbers, exiting with an
+ * error message if any of them isn't a system call.
+ */
+static vector<int> filteredSysCallNumbers() {
+	vector<int> numbers;
+	for(const string& name: options.filter) {
+		auto found = systemCallNames.find(name);
+		if(found == systemCallNames.end()) {
+			cerr << "trace: unknown system call \"" << name << "\"" << endl;
+			exit(1);
+		}
+		numbers.push_back(found->second);
+	}
+	return numbers;
 }
 
 int main(int argc, char *argv[]) {
 	// pre process
-	bool simple = false, rebuild = false;
-	int numFlags = processCommandLineFlags(simple, rebuild, argv);
+	int numFlags = processCommandLineFlags(options, argv);
+	bool filtered = !options.filter.empty();
 	if (argc - numFlags == 1) {
 		cout << "Nothing to trace... exiting." << endl;
 		return 0;
 	}
-	compileMaps(rebuild);
+	compileMaps(options.rebuild);
+	flattenMaps();
+	vector<int> filter = filteredSysCallNumbers();
 	argv += (1 + numFlags);
+	int recordFD = -1;
+	if(!options.recordFile.empty()) {
+		recordFD = open(options.recordFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if(recordFD == -1) {
+			cerr << "trace: couldn't open " << options.recordFile << ": " << strerror(errno) << endl;
+			return 1;
+		}
+	}
 
 	// start child process
 	pid_t pid = fork();
 	if(pid == 0) {
 		ptrace(PTRACE_TRACEME);
 		raise(SIGTRAP);
+		// the filter applies from here on, so the tracer hears about the execvp if it asked to
+		if(filtered && !installSeccompFilter(filter)) {
+			cerr << "trace: couldn't install seccomp filter: " << strerror(errno) << endl;
+			_exit(1);
+		}
 		execvp(argv[0], argv);
 	}
 
+	// from here on, output is queued for writer threads rather than written by the tracing loop
+	TraceWriter output(STDOUT_FILENO);
+	streambuf *terminal = cout.rdbuf(output.streambuf());
+	unique_ptr<TraceWriter> recording;
+	if(recordFD != -1) {
+		recording.reset(new TraceWriter(recordFD));
+		recorder = recording.get();
+		traceFileHeader header = traceFileHeader();
+		copy(kTraceFileMagic, kTraceFileMagic + sizeof(kTraceFileMagic), header.magic);
+		header.version = kTraceFileVersion;
+		header.follow = options.follow;
+		recorder->write(&header, sizeof(header));
+	}
+
 	// skip the tgkill system call
 	waitpid(pid, NULL, 0);
-	ptrace(PTRACE_SETOPTIONS, pid, 0, PTRACE_O_TRACESYSGOOD);
-	ptrace(PTRACE_SYSCALL, pid, 0, 0);
-
-	// detect system call
-	detectSysCall(pid, simple);
+	long ptraceOptions = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC;
+	if(filtered) ptraceOptions |= PTRACE_O_TRACESECCOMP;
+	if(options.follow || filtered) ptraceOptions |= PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE;
+	ptrace(PTRACE_SETOPTIONS, pid, 0, ptraceOptions);
+	ptrace(filtered ? PTRACE_CONT : PTRACE_SYSCALL, pid, 0, 0);
 
+	// detect system calls, then report how it all ended
+	int status = traceAll(pid);
+	if(options.summary) {
+		if(options.csv) {
+			summary.printCSV(cout, systemCallNumbers);
+		} else {
+			summary.print(cout, systemCallNumbers);
+		}
+	}
+	if(WIFSIGNALED(status)) {
+		cout << "Program was terminated by signal " << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status)) << ")" << endl;
+	} else {
+		cout << "Program exited normally with status " << WEXITSTATUS(status) << endl;
+	}
+	recording.reset();
+	if(recordFD != -1) close(recordFD);
+	cout.rdbuf(terminal);
 	return 0;
 }
@@ -0,0 +1,125 @@
+/**
+ * File: stsh-job-list-stress.cc
+ * -----------------------------
+ * Stress tests the STSHJobList the way stsh leans on it: a few hundred long-running
+ * background jobs sit in the list while thousands of short jobs are launched, each
+ * one reaped by a SIGCHLD handler that (just like stsh's) looks its pid up in the
+ * job list, marks the process terminated, and synchronizes the job.  The time the
+ * handler spends per reaped child is reported, and the run fails if any reaped
+ * pid couldn't be found or any job is left in the list at the end.
+ *
+ *    > ./stsh-job-list-stress
+ *    > ./stsh-job-list-stress 500 5000
+ */
+
+#include "stsh-job-list.h"
+#include "stsh-job.h"
+#include "stsh-process.h"
+#include "stsh-signal.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+using namespace std;
+
+static STSHJobList joblist;
+static size_t reaped = 0;
+static size_t strays = 0;           // reaped children the job list didn't know about
+static double handlerSeconds = 0;
+static double slowestReap = 0;
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void reapChildren(int sig) {
+  while (true) {
+    int status;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid <= 0) break;
+    double start = now();
+    if (!joblist.containsProcess(pid)) {
+      strays++;
+      continue;
+    }
+    STSHJob& job = joblist.getJobWithProcess(pid);
+    job.getProcess(pid).setState(kTerminated);
+    joblist.synchronize(job);
+    double elapsed = now() - start;
+    handlerSeconds += elapsed;
+    slowestReap = max(slowestReap, elapsed);
+    reaped++;
+  }
+}
+
+/**
+ * Function: launchJob
+ * -------------------
+ * Forks a child that either exits right away or waits to be killed, and adds it
+ * to the job list as a background job of its own.  SIGCHLD must be blocked, so
+ * the child can't be reaped before it's been added.
+ */
+static pid_t launchJob(bool shortLived) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (!shortLived) pause();
+    _exit(0);
+  }
+
+  command description;
+  memset(&description, 0, sizeof(description));
+  strcpy(description.command, shortLived ? "short" : "long");
+  STSHJob& job = joblist.addJob(kBackground);
+  job.addProcess(STSHProcess(pid, description));
+  return pid;
+}
+
+int main(int argc, char *argv[]) {
+  size_t numLongJobs = argc > 1 ? atoi(argv[1]) : 300;
+  size_t numShortJobs = argc > 2 ? atoi(argv[2]) : 3000;
+  installSignalHandler(SIGCHLD, reapChildren);
+  sigset_t chld, existing;
+  sigemptyset(&chld);
+  sigaddset(&chld, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &chld, &existing);
+
+  vector<pid_t> longJobs;
+  for (size_t i = 0; i < numLongJobs; i++) longJobs.push_back(launchJob(false));
+
+  double start = now();
+  for (size_t i = 0; i < numShortJobs; i++) {
+    launchJob(true);
+    sigprocmask(SIG_SETMASK, &existing, NULL); // give the handler its chance to reap
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+  }
+  while (reaped + strays < numShortJobs) sigsuspend(&existing);
+  double shortSeconds = now() - start;
+  size_t shortReaped = reaped;
+  double shortHandlerSeconds = handlerSeconds;
+
+  for (pid_t pid: longJobs) kill(pid, SIGKILL);
+  while (reaped + strays < numShortJobs + numLongJobs) sigsuspend(&existing);
+  sigprocmask(SIG_SETMASK, &existing, NULL);
+
+  cout << numShortJobs << " short jobs (alongside " << numLongJobs << " long ones) launched and reaped in "
+       << shortSeconds << " seconds" << endl;
+  cout << "SIGCHLD handler time per reaped child: " << (shortReaped == 0 ? 0 : shortHandlerSeconds / shortReaped * 1e6)
+       << " microseconds on average, " << slowestReap * 1e6 << " at most" << endl;
+
+  ostringstream leftovers;
+  leftovers << joblist;
+  if (strays > 0 || !leftovers.str().empty()) {
+    cerr << strays << " reaped children weren't in the job list, and these jobs were never removed:" << endl
+         << leftovers.str();
+    return 1;
+  }
+  return 0;
+}
@@ -14,7 +14,7 @@ using namespace std;
 STSHJob STSHJobList::njob; // njob stands for no-job
 
 STSHJob& STSHJobList::addJob(const STSHJobState& state) {
-  jobs[next] = STSHJob(next, state);
+  jobs[next] = STSHJob(next, state, &processIndex);
   return jobs[next++];
 }
 
@@ -57,14 +57,9 @@ bool STSHJobList::containsProcess(pid_t pid) const {
 }
 
 STSHJob& STSHJobList::getJobWithProcess(pid_t pid) {
-  for (pair<const size_t, STSHJob>& p: jobs) {
-    STSHJob& job = p.second;    
-    if (job.containsProcess(pid)) {
-      return job;
-    }
-  }
-  
-  return njob;
+  auto found = processIndex.find(pid);
+  if (found == processIndex.end()) return njob;
+  return getJob(found->second);
 }
 
 const STSHJob& STSHJobList::getJobWithProcess(pid_t pid) const {
@@ -91,11 +86,39 @@ void STSHJobList::synchronize(STSHJob& job) {
     }
   }
   
+  for (const STSHProcess& process: processes) {
+    auto found = processIndex.find(process.getID());
+    // the pid may have been recycled for a later job's process since this one exited
+    if (found != processIndex.end() && found->second == job.getNum()) processIndex.erase(found);
+  }
   jobs.erase(job.getNum());
 }
 
+bool STSHJobList::hasFreeSlot() const {
+  return slotLimit == 0 || jobs.size() - queue.size() < slotLimit;
+}
+
+STSHJob& STSHJobList::queueJob(const string& commandLine) {
+  queue[next] = commandLine;
+  return addJob(kBackground);
+}
+
+STSHJob& STSHJobList::dequeueJob(string& commandLine) {
+  auto oldest = queue.begin();
+  size_t num = oldest->first;
+  commandLine = oldest->second;
+  queue.erase(oldest);
+  return getJob(num);
+}
+
 ostream& operator<<(ostream& os, const STSHJobList& joblist) {
   for (const pair<size_t, STSHJob>& p: joblist.jobs) 
     os << p.second << endl;
   return os;
 }
+
+ostream& STSHJobList::printUsage(ostream& os) const {
+  for (const pair<const size_t, STSHJob>& p: jobs)
+    p.second.printUsage(os) << endl;
+  return os;
+}
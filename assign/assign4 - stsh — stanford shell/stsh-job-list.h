@@ -48,6 +48,15 @@ class STSHJobList {
 
 public:
 
+/**
+ * Method: printUsage
+ * ------------------
+ * Inserts the job list into os as operator<< would, but with each job's
+ * resource usage listed as STSHJob::printUsage lists it.
+ */
+  std::ostream& printUsage(std::ostream& os) const;
+
+
 /**
  * Method: addJob
  * --------------
@@ -101,6 +110,9 @@ public:
  * -----------------------
  * Returns true iff some process within some
  * job within the job list has the specified pid.
+ * This (and getJobWithProcess) is a hash lookup rather
+ * than a search of every job, so it's cheap enough to
+ * call for each child reaped, however many jobs there are.
  */
   bool containsProcess(pid_t pid) const;
 
@@ -127,9 +139,74 @@ public:
  * a foreground job).
  */  
   void synchronize(STSHJob& job);
+
+/**
+ * Method: isEmpty
+ * ---------------
+ * Returns true iff the job list contains no jobs at all, queued or otherwise.
+ */
+  bool isEmpty() const { return jobs.empty(); }
+
+/**
+ * Methods: setSlotLimit, getSlotLimit
+ * -----------------------------------
+ * Set and get the number of job slots: the most jobs that should be started
+ * (and not yet finished) at once.  0, the default, means there's no limit.
+ * Lowering the limit doesn't stop any jobs already started.
+ */
+  void setSlotLimit(size_t limit) { slotLimit = limit; }
+  size_t getSlotLimit() const { return slotLimit; }
+
+/**
+ * Method: hasFreeSlot
+ * -------------------
+ * Returns true iff another job can be started without exceeding the
+ * slot limit.  Queued jobs don't occupy slots.
+ */
+  bool hasFreeSlot() const;
+
+/**
+ * Method: queueJob
+ * ----------------
+ * Inserts a new background STSHJob into the job list, just as addJob does,
+ * except the job is queued to be started later rather than started right
+ * away: its processes should be added in the kWaiting state, with pids of 0.
+ * commandLine is whatever the job should be started from, once it's reached
+ * the front of the queue and there's a slot free for it.
+ */
+  STSHJob& queueJob(const std::string& commandLine);
+
+/**
+ * Method: isQueued
+ * ----------------
+ * Returns true iff the job with the specified job number is queued.
+ */
+  bool isQueued(size_t num) const { return queue.find(num) != queue.end(); }
+
+/**
+ * Method: hasQueuedJob
+ * --------------------
+ * Returns true iff any job is queued.
+ */
+  bool hasQueuedJob() const { return !queue.empty(); }
+
+/**
+ * Method: dequeueJob
+ * ------------------
+ * Removes the job that's been queued the longest from the queue, places the
+ * command line it was queued with into commandLine, and returns a reference to
+ * it.  The job stays in the job list, and the caller is expected to start it,
+ * replacing its waiting processes with the ones it starts (or leaving it
+ * empty and synchronizing it, to remove it, if none can be).  Calls to this
+ * method should be guarded by calls to hasQueuedJob.
+ */
+  STSHJob& dequeueJob(std::string& commandLine);
   
 private:
   size_t next = 1;
   std::map<size_t, STSHJob> jobs; // maps work, because we want to publish in order of job number
+  STSHProcessIndex processIndex; // pid -> job number, for every process in every job
+  std::map<size_t, std::string> queue; // job number -> command line; job numbers only grow, so it's first in, first out
+  size_t slotLimit = 0;
   static STSHJob njob;
 };
@@ -5,12 +5,18 @@
  */
 
 #include "stsh-job.h"
+#include <algorithm> // for max, min
 #include <iomanip> // for setw
 #include <sstream> // for ostringstream
 using namespace std;
 
 STSHProcess STSHJob::nprocess;
 
+void STSHJob::addProcess(const STSHProcess& process) {
+  processes.push_back(process);
+  if (index != NULL && process.getID() != 0) (*index)[process.getID()] = num; // queued jobs' processes have no pids yet
+}
+
 bool STSHJob::containsProcess(pid_t pid) const {
   const STSHProcess& process = getProcess(pid);
   return &process != &nprocess;
@@ -43,3 +49,28 @@ ostream& operator<<(ostream& os, const STSHJob& job) {
 
   return os;
 }
+
+ostream& STSHJob::printUsage(ostream& os) const {
+  ostringstream oss;
+  oss << "[" << num << "]";
+  os << setw(oss.str().size()) << oss.str() << " ";
+  if (processes.empty()) return os << "(job is empty, devoid of processes)";
+
+  double user = 0, system = 0;
+  double firstStart = processes[0].getStartTime(), lastEnd = processes[0].getEndTime();
+  long maxResidentSize = 0;
+  for (size_t i = 0; i < processes.size(); i++) {
+    const STSHProcess& process = processes[i];
+    if (i > 0) os << " |" << endl << setw(oss.str().size()) << " " << " ";
+    process.printUsage(os);
+    user += process.getUserTime();
+    system += process.getSystemTime();
+    maxResidentSize = max(maxResidentSize, process.getMaxResidentSize());
+    firstStart = min(firstStart, process.getStartTime());
+    lastEnd = max(lastEnd, process.getEndTime());
+  }
+
+  os << endl << setw(oss.str().size()) << " " << " " << setw(5) << " " << " " << setw(12) << left << "Total" << right
+     << " " << formatUsage(user, system, maxResidentSize, lastEnd - firstStart);
+  return os;
+}
@@ -25,6 +25,7 @@
 #include <cstddef>  // for size_t
 #include <vector>   // for vector
 #include <iostream> // for ostream
+#include <unordered_map> // for unordered_map
 
 /**
  * Enumerated Type: STSHJobState
@@ -37,6 +38,14 @@
  */
 enum STSHJobState { kForeground, kBackground };
 
+/**
+ * Type: STSHProcessIndex
+ * ----------------------
+ * Maps process ids to the numbers of the jobs they belong to.  The STSHJobList
+ * owns one, and each of its jobs records its processes there as they're added.
+ */
+typedef std::unordered_map<pid_t, size_t> STSHProcessIndex;
+
 class STSHJob {
 
 /**
@@ -56,14 +65,16 @@ public:
  * Default constructor, where the job number is just set to 0 (with the understanding
  * that all legitimate job numbers are actually supposed to be positive).
  */
-  STSHJob(): num(0) {}
+  STSHJob(): num(0), index(NULL) {}
 
 /**
  * Constructor: STSHJob
  * --------------------
  * Constructs an instance of STSHJob with the specified job number and state.
+ * If an index is supplied, every process added to the job is recorded there.
  */
-  STSHJob(size_t num, STSHJobState state) : num(num), state(state) {}
+  STSHJob(size_t num, STSHJobState state, STSHProcessIndex *index = NULL) :
+    num(num), state(state), index(index) {}
 
 /**
  * Method: STSHJob
@@ -77,7 +88,7 @@ public:
  * ------------------
  * Appends the provided STSHProcess to be sequence of previously appended processes.
  */
-  void addProcess(const STSHProcess& process) { processes.push_back(process); }
+  void addProcess(const STSHProcess& process);
 
 /**
  * Method: getProcesses
@@ -127,9 +138,20 @@ public:
  */
   pid_t getGroupID() const { return processes.empty() ? 0 : processes[0].getID(); }
 
+/**
+ * Method: printUsage
+ * ------------------
+ * Inserts the job into os as operator<< would, but with every process's
+ * resource usage (see STSHProcess::printUsage) and a closing line totaling
+ * the job's: the CPU time of all its processes, the largest resident set any
+ * one of them had, and the time from the first's start to the last's end.
+ */
+  std::ostream& printUsage(std::ostream& os) const;
+
 private:
   size_t num;
   std::vector<STSHProcess> processes;
   STSHJobState state;
+  STSHProcessIndex *index;
   static STSHProcess nprocess;
 };
@@ -0,0 +1,114 @@
+/**
+ * File: stsh-launch-benchmark.cc
+ * ------------------------------
+ * Times how long stsh takes to run a pipeline of 2, 10 and 50 stages (or of
+ * whatever lengths are named on the command line), from the moment it starts
+ * creating the first process to the moment it's reaped the last.  Every stage
+ * is true, found on $PATH, so nearly all of that is launch time.  Each pipeline is run
+ * twice over: once by launchPipeline, which is what stsh uses, and once by
+ * forking and exec'ing each stage the way stsh used to, with every pipe
+ * created up front and each child closing all of the ones it doesn't use.
+ * (Timing launchPipeline alone wouldn't be fair, since posix_spawn returns
+ * only once the child has exec'd, and fork returns before.)
+ *
+ *    > ./stsh-launch-benchmark
+ *    > ./stsh-launch-benchmark 2 10 50 200
+ */
+
+#include "stsh-launch.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+using namespace std;
+
+static const size_t kTrials = 50;
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static vector<command> makeCommands(size_t stages) {
+  command stage;
+  memset(&stage, 0, sizeof(stage));
+  strcpy(stage.command, "true");
+  return vector<command>(stages, stage);
+}
+
+/**
+ * Function: forkPipeline
+ * ----------------------
+ * Launches the pipeline the way stsh did before launchPipeline, minus the
+ * redirection, and returns the pids.
+ */
+static vector<pid_t> forkPipeline(const vector<command>& commands, const sigset_t& childMask) {
+  size_t numPipes = commands.size() - 1;
+  vector<int> fds(2 * numPipes);
+  for (size_t i = 0; i < numPipes; i++) pipe(&fds[2 * i]);
+
+  vector<pid_t> pids;
+  pid_t pgid = 0;
+  for (size_t i = 0; i < commands.size(); i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      setpgid(0, pgid);
+      signal(SIGTTIN, SIG_DFL);
+      signal(SIGTTOU, SIG_DFL);
+      if (i > 0) dup2(fds[2 * (i - 1)], STDIN_FILENO);
+      if (i < numPipes) dup2(fds[2 * i + 1], STDOUT_FILENO);
+      for (int fd: fds) close(fd);
+      char *argv[] = {const_cast<char *>(commands[i].command), NULL};
+      sigprocmask(SIG_SETMASK, &childMask, NULL);
+      execvp(argv[0], argv);
+      _exit(1);
+    }
+    if (i == 0) pgid = pid;
+    setpgid(pid, pgid);
+    pids.push_back(pid);
+  }
+  for (int fd: fds) close(fd);
+  return pids;
+}
+
+static double timeLaunches(size_t stages, bool spawn, const sigset_t& childMask) {
+  vector<command> commands = makeCommands(stages);
+  STSHPathCache paths; // as stsh's would be, once it's run the command once
+  double total = 0;
+  for (size_t trial = 0; trial < kTrials; trial++) {
+    double start = now();
+    vector<pid_t> pids = spawn ? launchPipeline(commands, "", "", childMask, false, paths) : forkPipeline(commands, childMask);
+    for (pid_t pid: pids) {
+      if (pid == -1) {
+        cerr << "Couldn't launch " << commands[0].command << "." << endl;
+        exit(1);
+      }
+      waitpid(pid, NULL, 0);
+    }
+    total += now() - start;
+  }
+  return total / kTrials;
+}
+
+int main(int argc, char *argv[]) {
+  vector<size_t> lengths;
+  for (int i = 1; i < argc; i++) lengths.push_back(atoi(argv[i]));
+  if (lengths.empty()) lengths = {2, 10, 50};
+
+  sigset_t childMask;
+  sigprocmask(SIG_SETMASK, NULL, &childMask);
+  cout << setw(8) << "stages" << setw(16) << "fork (usec)" << setw(16) << "spawn (usec)" << endl;
+  for (size_t stages: lengths) {
+    double forked = timeLaunches(stages, false, childMask);
+    double spawned = timeLaunches(stages, true, childMask);
+    cout << setw(8) << stages << fixed << setprecision(1)
+         << setw(16) << forked * 1e6 << setw(16) << spawned * 1e6 << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * File: stsh-launch-tty-test.cc
+ * -----------------------------
+ * Checks that launchPipeline hands the terminal to a foreground pipeline before
+ * its first process can read from it.  Each trial runs a pipeline whose first
+ * stage is cat, reading the terminal, on a pseudo-terminal of its own, from a
+ * process that stands in for stsh: it leads the terminal's session, sits in the
+ * foreground, and ignores SIGTTIN and SIGTTOU.  The test then types a line and
+ * an EOF.  A pipeline launched into the background, even for a moment, is
+ * stopped by SIGTTIN the moment cat reads, and the trial fails.  Since that's a
+ * race, each pipeline is run many times over.
+ *
+ *    > ./stsh-launch-tty-test
+ *    > ./stsh-launch-tty-test 100
+ */
+
+#include "stsh-launch.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+static const int kTimeout = 5; // seconds a trial may take before it's considered hung
+
+static command makeCommand(const char *name, const char *arg = NULL) {
+  command c;
+  memset(&c, 0, sizeof(c));
+  strcpy(c.command, name);
+  if (arg != NULL) c.tokens[0] = const_cast<char *>(arg);
+  return c;
+}
+
+/**
+ * Function: launchOnTerminal
+ * --------------------------
+ * Runs in the process standing in for stsh, with the pseudo-terminal named by
+ * slave as its controlling terminal.  Launches commands in the foreground and
+ * waits for them, and returns the number of processes that were stopped.
+ */
+static int launchOnTerminal(const char *slave, const vector<command>& commands) {
+  setsid();
+  int fd = open(slave, O_RDWR); // the first terminal a session leader opens becomes its own
+  if (fd == -1) return 1;
+  dup2(fd, STDIN_FILENO);
+  dup2(fd, STDOUT_FILENO);
+  dup2(fd, STDERR_FILENO);
+  close(fd);
+  signal(SIGTTIN, SIG_IGN); // as stsh does
+  signal(SIGTTOU, SIG_IGN);
+  alarm(kTimeout);
+
+  sigset_t childMask;
+  sigprocmask(SIG_SETMASK, NULL, &childMask);
+  STSHPathCache paths;
+  cout << "ready" << endl;
+  vector<pid_t> pids = launchPipeline(commands, "", "", childMask, true, paths);
+  int numStopped = 0;
+  for (pid_t pid: pids) {
+    int status;
+    if (pid == -1 || waitpid(pid, &status, WUNTRACED) == -1) return 1;
+    if (WIFSTOPPED(status)) {
+      numStopped++;
+      kill(pid, SIGKILL); // so that the stages after it see EOF
+      waitpid(pid, NULL, 0);
+    }
+  }
+  return numStopped;
+}
+
+/**
+ * Function: runTrial
+ * ------------------
+ * Runs commands in the foreground of a new pseudo-terminal, types a line and an
+ * EOF at it, and returns true iff no process was stopped and nothing hung.
+ */
+static bool runTrial(const vector<command>& commands) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master == -1 || grantpt(master) == -1 || unlockpt(master) == -1) {
+    cerr << "Couldn't open a pseudo-terminal." << endl;
+    exit(1);
+  }
+  string slave = ptsname(master);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(master);
+    _exit(launchOnTerminal(slave.c_str(), commands));
+  }
+
+  // type nothing until the terminal is the child's, or it might not be read
+  string output;
+  char buf[256];
+  ssize_t count;
+  while (output.find("ready") == string::npos && (count = read(master, buf, sizeof(buf))) > 0) {
+    output.append(buf, count);
+  }
+  const char input[] = "hello\n\004";
+  write(master, input, sizeof(input) - 1);
+  while (read(master, buf, sizeof(buf)) > 0); // until the child's gone, and the terminal with it
+  close(master);
+
+  int status;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  int numTrials = argc > 1 ? atoi(argv[1]) : 20;
+  if (numTrials < 1) {
+    cerr << "Usage: " << argv[0] << " [trials]" << endl;
+    return 1;
+  }
+
+  vector<vector<command>> pipelines = {
+    {makeCommand("cat"), makeCommand("cat")},
+    {makeCommand("cat"), makeCommand("sleep", "0.3")},
+  };
+  vector<string> names = {"cat | cat", "cat | sleep 0.3"};
+  int numFailed = 0;
+  for (size_t i = 0; i < pipelines.size(); i++) {
+    int failures = 0;
+    for (int trial = 0; trial < numTrials; trial++) {
+      if (!runTrial(pipelines[i])) failures++;
+    }
+    cout << (failures == 0 ? "PASS" : "FAIL") << ": " << names[i] << ", " << failures << " of "
+         << numTrials << " trials stopped or hung" << endl;
+    if (failures > 0) numFailed++;
+  }
+  return numFailed == 0 ? 0 : 1;
+}
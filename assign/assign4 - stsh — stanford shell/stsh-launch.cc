@@ -0,0 +1,194 @@
+/**
+ * File: stsh-launch.cc
+ * --------------------
+ * Presents the implementation of launchPipeline.  Every descriptor it opens is
+ * close-on-exec, so each spawned process inherits just the two it's handed by
+ * its file actions (dup2 clears the flag on the copy).  No process has to close
+ * the ends of the other pipes, as forked children did.
+ */
+
+#include "stsh-launch.h"
+#include "stsh-exception.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+using namespace std;
+
+static const int kNoRedirection = -1;
+
+static int openRedirection(const string& file, int flags) {
+  if (file.empty()) return kNoRedirection;
+  int fd = open(file.c_str(), flags | O_CLOEXEC, 0644);
+  if (fd == -1) throw STSHException("Could not open \"" + file + "\": " + strerror(errno) + ".");
+  return fd;
+}
+
+#ifndef POSIX_SPAWN_TCSETPGROUP
+/**
+ * Function: forkLeader
+ * --------------------
+ * Starts the first process of a foreground job the way stsh did before it used
+ * posix_spawn: the child puts itself in a new group and takes the terminal for
+ * it before it execs, so it never reads the terminal from the background (and
+ * is stopped by SIGTTIN) however soon it gets to it.  Without
+ * POSIX_SPAWN_TCSETPGROUP, posix_spawn can't do that, and stsh would only hand
+ * the terminal over after spawning the last stage.  A close-on-exec pipe
+ * carries back the error number if the exec fails, and waiting on it also means
+ * the group has the terminal before any other stage is started.  Returns as
+ * spawnCommand does.
+ */
+static int forkLeader(const string& path, char *argv[], int in, int out, const sigset_t& childMask, pid_t& pid) {
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) == -1) return errno;
+  pid = fork();
+  if (pid == -1) {
+    int err = errno;
+    close(fds[0]);
+    close(fds[1]);
+    return err;
+  }
+
+  if (pid == 0) {
+    setpgid(0, 0);
+    tcsetpgrp(STDIN_FILENO, getpgrp()); // stsh ignores SIGTTOU, so this can't stop us
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    if (in != STDIN_FILENO) dup2(in, STDIN_FILENO);
+    if (out != STDOUT_FILENO) dup2(out, STDOUT_FILENO);
+    sigprocmask(SIG_SETMASK, &childMask, NULL);
+    execv(path.c_str(), argv);
+    int err = errno;
+    write(fds[1], &err, sizeof(err));
+    _exit(127);
+  }
+
+  setpgid(pid, pid); // as the child does, so it's done whichever of the two gets there first
+  close(fds[1]);
+  int err = 0;
+  ssize_t count;
+  do {
+    count = read(fds[0], &err, sizeof(err));
+  } while (count == -1 && errno == EINTR);
+  close(fds[0]);
+  if (count <= 0) return 0; // the exec succeeded and closed the pipe
+  waitpid(pid, NULL, 0);
+  return err;
+}
+#endif
+
+/**
+ * Function: spawnCommand
+ * ----------------------
+ * Spawns the executable at path to run command with in and out (unless they're
+ * already 0 and 1) as its stdin and stdout, in process group pgid (0 for a new
+ * group of its own).  Places its pid in pid and returns 0, or returns the error
+ * number if it couldn't be spawned.
+ */
+static int spawnCommand(const string& path, const command& command, int in, int out, pid_t pgid,
+                        const sigset_t& childMask, bool foreground, pid_t& pid) {
+  char *argv[kMaxArguments + 2] = {NULL};
+  argv[0] = const_cast<char *>(command.command);
+  for (size_t j = 0; j < kMaxArguments && command.tokens[j] != NULL; j++) {
+    argv[j + 1] = command.tokens[j];
+  }
+#ifndef POSIX_SPAWN_TCSETPGROUP
+  if (foreground && pgid == 0 && isatty(STDIN_FILENO)) return forkLeader(path, argv, in, out, childMask, pid);
+#endif
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if (in != STDIN_FILENO) posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+  if (out != STDOUT_FILENO) posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  short flags = POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+  posix_spawnattr_setpgroup(&attr, pgid);
+  posix_spawnattr_setsigmask(&attr, &childMask);
+  sigset_t defaults; // stsh ignores these, and an exec alone wouldn't undo that
+  sigemptyset(&defaults);
+  sigaddset(&defaults, SIGTTIN);
+  sigaddset(&defaults, SIGTTOU);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+#ifdef POSIX_SPAWN_TCSETPGROUP
+  // the first process takes the terminal before it runs a single instruction of its own
+  if (foreground && pgid == 0 && isatty(STDIN_FILENO)) {
+    flags |= POSIX_SPAWN_TCSETPGROUP;
+    posix_spawnattr_tcsetpgrp_np(&attr, STDIN_FILENO);
+  }
+#endif
+  posix_spawnattr_setflags(&attr, flags);
+
+  int err = posix_spawn(&pid, path.c_str(), &actions, &attr, argv, environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  return err;
+}
+
+/**
+ * Function: launchCommand
+ * -----------------------
+ * Spawns command (as spawnCommand does) from the path paths has for it.  If
+ * that fails, the path may be stale (the file moved, say, or an earlier $PATH
+ * directory gained one of the same name), so $PATH is searched once more
+ * before giving up.  A path that can't be exec'd isn't left in the cache.
+ * Returns the new process's pid, or -1 if it couldn't be spawned.
+ */
+static pid_t launchCommand(const command& command, int in, int out, pid_t pgid,
+                           const sigset_t& childMask, bool foreground, STSHPathCache& paths) {
+  pid_t pid;
+  string path = paths.lookup(command.command);
+  int err = path.empty() ? ENOENT : spawnCommand(path, command, in, out, pgid, childMask, foreground, pid);
+  if (err != 0 && !path.empty()) {
+    paths.forget(command.command);
+    string current = paths.lookup(command.command);
+    if (!current.empty() && current != path) err = spawnCommand(current, command, in, out, pgid, childMask, foreground, pid);
+    if (err != 0) paths.forget(command.command);
+  }
+
+  if (err != 0) {
+    cerr << command.command << ": " << (err == ENOENT ? "Command not found" : strerror(err)) << endl;
+    return -1;
+  }
+  return pid;
+}
+
+vector<pid_t> launchPipeline(const vector<command>& commands, const string& input, const string& output,
+                             const sigset_t& childMask, bool foreground, STSHPathCache& paths) {
+  int infd = openRedirection(input, O_RDONLY);
+  int outfd;
+  try {
+    outfd = openRedirection(output, O_WRONLY | O_CREAT | O_TRUNC);
+  } catch (const STSHException& e) {
+    if (infd != kNoRedirection) close(infd);
+    throw;
+  }
+
+  vector<pid_t> pids;
+  pid_t pgid = 0;
+  int in = infd == kNoRedirection ? STDIN_FILENO : infd;
+  for (size_t i = 0; i < commands.size(); i++) {
+    int fds[2] = {kNoRedirection, kNoRedirection};
+    int out = outfd == kNoRedirection ? STDOUT_FILENO : outfd;
+    if (i < commands.size() - 1) {
+      pipe2(fds, O_CLOEXEC);
+      out = fds[1];
+    }
+
+    pid_t pid = launchCommand(commands[i], in, out, pgid, childMask, foreground, paths);
+    if (pgid == 0) pgid = max(pid, 0);
+    pids.push_back(pid);
+
+    if (in != STDIN_FILENO) close(in);
+    if (fds[1] != kNoRedirection) close(fds[1]);
+    in = fds[0];
+  }
+
+  if (outfd != kNoRedirection) close(outfd);
+  return pids;
+}
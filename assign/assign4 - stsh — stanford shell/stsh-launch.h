@@ -0,0 +1,37 @@
+/**
+ * File: stsh-launch.h
+ * -------------------
+ * Defines the launchPipeline function, which starts every process of a
+ * pipeline with posix_spawn rather than fork and exec.
+ */
+
+#pragma once
+#include "stsh-parser/stsh-parse.h"
+#include "stsh-path-cache.h"
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ * Function: launchPipeline
+ * ------------------------
+ * Spawns one process per command, each reading what the one before it writes
+ * through a pipe.  The first reads from the file named by input (or stsh's own
+ * stdin, if input is empty), and the last writes to the file named by output
+ * (or stsh's stdout), which is created if need be and truncated.  All of them
+ * are placed in a new process group led by the first, start with the signal
+ * mask childMask and default SIGTTIN and SIGTTOU handling, and, if foreground
+ * is true, own the terminal from the moment they start.  (Where posix_spawn
+ * can't hand over the terminal itself, the first process of a foreground
+ * pipeline is forked, and takes the terminal before it execs.)  Each is exec'd
+ * from the path paths has cached for it, which saves searching $PATH every time.
+ *
+ * Returns the pids of the processes, one per command and in the same order.  A
+ * command that can't be spawned (because there's no such program, say) is
+ * reported on cerr and its pid is -1.  If either file can't be opened, nothing's
+ * spawned and an STSHException is thrown.
+ */
+std::vector<pid_t> launchPipeline(const std::vector<command>& commands, const std::string& input,
+                                  const std::string& output, const sigset_t& childMask, bool foreground,
+                                  STSHPathCache& paths);
@@ -14,16 +14,22 @@
 #include <functional> 
 #include <cctype>
 #include <locale>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <getopt.h>
+#include <unistd.h>
 #include "string-utils.h"
 using namespace std;
 
 static string prompt = "stsh> ";
 static bool history = true;
+static bool batch = false;
+static int input = STDIN_FILENO;
 static const int kIncorrectUsage = 1;
 static void printUsage(const string& message, const string& executable) {
   cerr << "Error: " << message << endl;
-  cerr << "Usage: ./" << executable << " [--suppress-prompt] [--no-history]" << endl;
+  cerr << "Usage: ./" << executable << " [--suppress-prompt] [--no-history] [--batch [<file>]]" << endl;
   exit(kIncorrectUsage);
 }
 
@@ -31,11 +37,12 @@ void rlinit(int argc, char *argv[]) {
   struct option options[] = {
     {"suppress-prompt", no_argument, NULL, 's'},
     {"no-history", no_argument, NULL, 'n'},
+    {"batch", no_argument, NULL, 'b'},
     {NULL, 0, NULL, 0},
   };
 
   while (true) {
-    int ch = getopt_long(argc, argv, "sn", options, NULL);
+    int ch = getopt_long(argc, argv, "snb", options, NULL);
     if (ch == -1) break;
     switch (ch) {
     case 's':
@@ -44,13 +51,30 @@ void rlinit(int argc, char *argv[]) {
     case 'n':
       history = false;
       break;
+    case 'b':
+      batch = true;
+      prompt = "";
+      history = false;
+      break;
     default:
       printUsage("Unrecognized flag.", argv[0]);
     }
   }
 
-  argc -= optind;
-  if (argc > 0) printUsage("Too many arguments.", argv[0]);
+  int numArgs = argc - optind;
+  if (numArgs > (batch ? 1 : 0)) printUsage("Too many arguments.", argv[0]);
+  if (numArgs == 1) {
+    input = open(argv[optind], O_RDONLY | O_CLOEXEC);
+    if (input == -1) printUsage(string("Could not open \"") + argv[optind] + "\": " + strerror(errno) + ".", argv[0]);
+  }
+}
+
+bool rlbatch() {
+  return batch;
+}
+
+int rlinput() {
+  return input;
 }
 
 bool readline(string& line) {
@@ -71,3 +95,77 @@ bool readline(string& line) {
     add_history(line.c_str());
   return true;
 }
+
+/**
+ * The state shared by rlprompt, rlready and rlread.  Without history, input is read
+ * into pending a block at a time and split into lines there; with it, readline's
+ * callback interface hands each finished line to completeLine.
+ */
+static string pending;
+static string completed;
+static bool lineCompleted = false;
+static bool eofReached = false;
+
+static void completeLine(char *s) {
+  rl_callback_handler_remove(); // so readline leaves the terminal alone until the next prompt
+  lineCompleted = true;
+  if (s == NULL) {
+    eofReached = true;
+    return;
+  }
+
+  completed = s;
+  free(s);
+}
+
+void rlprompt() {
+  if (history) {
+    rl_callback_handler_install(prompt.c_str(), completeLine);
+  } else {
+    cout << prompt << flush;
+  }
+}
+
+bool rlready() {
+  return lineCompleted || eofReached || pending.find('\n') != string::npos;
+}
+
+static bool finishLine(string& line, bool& eof) {
+  eof = eofReached && completed.empty();
+  line = completed;
+  completed.clear();
+  lineCompleted = false;
+  trim(line);
+  if (history && !line.empty())
+    add_history(line.c_str());
+  return true;
+}
+
+bool rlread(string& line, bool& eof) {
+  line.clear();
+  eof = false;
+  if (history) {
+    if (!lineCompleted) rl_callback_read_char();
+    return lineCompleted ? finishLine(line, eof) : false;
+  }
+
+  if (!rlready()) {
+    char buffer[4096];
+    ssize_t count = read(input, buffer, sizeof(buffer));
+    if (count == -1 && (errno == EINTR || errno == EAGAIN)) return false;
+    if (count <= 0) eofReached = true;
+    else pending.append(buffer, count);
+  }
+
+  size_t newline = pending.find('\n');
+  if (newline != string::npos) {
+    completed = pending.substr(0, newline);
+    pending.erase(0, newline + 1);
+  } else if (eofReached) {
+    completed = pending; // a last line with no newline
+    pending.clear();
+  } else {
+    return false;
+  }
+  return finishLine(line, eof);
+}
@@ -19,6 +19,17 @@
  */
 void rlinit(int argc, char *argv[]);
 
+/**
+ * Functions: rlbatch, rlinput
+ * ---------------------------
+ * rlbatch returns true iff stsh was started in batch mode (--batch/-b), where
+ * commands are read without a prompt, line editing or history, from the file
+ * named after the flag or else from stdin.  rlinput returns the descriptor
+ * rlread reads commands from, which is stdin unless a batch file was named.
+ */
+bool rlbatch();
+int rlinput();
+
 /**
  * Function: readline
  * ------------------
@@ -29,4 +40,21 @@ void rlinit(int argc, char *argv[]);
  */
 bool readline(std::string& line);
 
+/**
+ * Functions: rlprompt, rlready, rlread
+ * ------------------------------------
+ * A non-blocking alternative to readline, for callers that wait on stdin
+ * alongside other descriptors (with poll, say) rather than block in readline.
+ * rlprompt displays the prompt and readies the module for a new line.
+ * rlready returns true if a line (or EOF) has already been read in, so that
+ * rlread can supply it without stdin being readable.  rlread should be called
+ * whenever rlinput() is readable or rlready returns true: it consumes whatever input
+ * is available without blocking, and returns true once it's placed a complete
+ * line into line, or detected EOF (in which case eof is set to true).  Lines are
+ * trimmed and added to the history just as readline's are.
+ */
+void rlprompt();
+bool rlready();
+bool rlread(std::string& line, bool& eof);
+
 #endif
@@ -0,0 +1,79 @@
+/**
+ * File: stsh-path-cache.cc
+ * ------------------------
+ * Presents the implementation of the STSHPathCache class.
+ */
+
+#include "stsh-path-cache.h"
+#include <cstdlib>
+#include <iomanip>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+/**
+ * Function: isExecutable
+ * ----------------------
+ * Returns true iff path names a regular file we're allowed to execute, which
+ * is what execvp would have settled on.
+ */
+static bool isExecutable(const string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(path.c_str(), X_OK) == 0;
+}
+
+string STSHPathCache::lookup(const string& command) {
+  if (command.find('/') != string::npos) return command;
+  validate();
+  auto found = paths.find(command);
+  if (found != paths.end()) {
+    found->second.hits++;
+    return found->second.path;
+  }
+
+  // as execvp does, an empty entry in $PATH means the current directory
+  size_t start = 0;
+  while (start <= searchPath.size()) {
+    size_t end = searchPath.find(':', start);
+    if (end == string::npos) end = searchPath.size();
+    string dir = searchPath.substr(start, end - start);
+    string path = (dir.empty() ? "." : dir) + "/" + command;
+    if (isExecutable(path)) {
+      paths[command] = {path, 1};
+      return path;
+    }
+    start = end + 1;
+  }
+  return "";
+}
+
+void STSHPathCache::forget(const string& command) {
+  paths.erase(command);
+}
+
+void STSHPathCache::clear() {
+  paths.clear();
+}
+
+/**
+ * Method: validate
+ * ----------------
+ * Drops the cache if $PATH isn't what it was when the cached paths were found.
+ * (An unset $PATH is searched as execvp would search it.)
+ */
+void STSHPathCache::validate() {
+  const char *current = getenv("PATH");
+  string path = current != NULL ? current : "/bin:/usr/bin";
+  if (path == searchPath) return;
+  paths.clear();
+  searchPath = path;
+}
+
+ostream& operator<<(ostream& os, const STSHPathCache& paths) {
+  if (paths.empty()) return os;
+  os << "hits" << "\t" << "command" << endl;
+  for (const pair<const string, STSHPathCache::entry>& p: paths.paths) {
+    os << setw(4) << p.second.hits << "\t" << p.second.path << endl;
+  }
+  return os;
+}
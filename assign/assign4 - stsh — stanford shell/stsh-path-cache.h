@@ -0,0 +1,76 @@
+/**
+ * File: stsh-path-cache.h
+ * -----------------------
+ * Defines the STSHPathCache class, which remembers where in $PATH each command
+ * stsh has run lives, so that stsh can launch it by its full path rather than
+ * search $PATH again (with a failed execve for every directory before the one
+ * it's in) each time.  It plays the part of bash's hash table:
+ *
+ *    STSHPathCache paths;
+ *    string path = paths.lookup("ls");   // searches $PATH: "/usr/bin/ls"
+ *    path = paths.lookup("ls");          // doesn't
+ *    paths.forget("ls");                 // say, because "/usr/bin/ls" couldn't be exec'd
+ *
+ * The whole cache is dropped whenever $PATH is found to have changed.
+ */
+
+#pragma once
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+
+class STSHPathCache {
+
+/**
+ * Overloaded version of operator<< so that the cache can be printed just as
+ * bash's hash builtin prints its table: one command per line, full path
+ * preceded by the number of times it's been looked up.
+ */
+  friend std::ostream& operator<<(std::ostream& os, const STSHPathCache& paths);
+
+public:
+
+/**
+ * Method: lookup
+ * --------------
+ * Returns the full path of the executable file named command, finding it in
+ * $PATH (and remembering where) if it isn't already cached.  A command with a
+ * '/' in it is a path already, and is returned as is without being cached.
+ * Returns the empty string if there's no such file in any $PATH directory.
+ */
+  std::string lookup(const std::string& command);
+
+/**
+ * Method: forget
+ * --------------
+ * Drops whatever path is cached for command, so the next lookup searches
+ * $PATH again.
+ */
+  void forget(const std::string& command);
+
+/**
+ * Method: clear
+ * -------------
+ * Drops every cached path.
+ */
+  void clear();
+
+/**
+ * Method: empty
+ * -------------
+ * Returns true iff no paths are cached.
+ */
+  bool empty() const { return paths.empty(); }
+
+private:
+  struct entry {
+    std::string path;
+    size_t hits;
+  };
+
+  std::string searchPath; // the value of $PATH the cached paths were found in
+  std::map<std::string, entry> paths; // a map, so the table prints in order of command name
+
+  void validate();
+};
@@ -6,14 +6,44 @@
 
 #include "stsh-process.h"
 #include <iomanip>  // for setw, left
+#include <sstream>  // for ostringstream
+#include <time.h>   // for clock_gettime
 using namespace std;
 
-STSHProcess::STSHProcess(pid_t pid, const command& command, STSHProcessState state) : pid(pid), state(state) {
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double seconds(const struct timeval& tv) {
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+STSHProcess::STSHProcess(pid_t pid, const command& command, STSHProcessState state) :
+  pid(pid), state(state), started(now()), finished(0), usage() {
   tokens.push_back(command.command);
   for (char * const *tokenp = &command.tokens[0]; *tokenp != NULL; tokenp++)
     tokens.push_back(*tokenp);
 }
 
+void STSHProcess::setState(STSHProcessState state) {
+  this->state = state;
+  if (state == kTerminated && finished == 0) finished = now();
+}
+
+double STSHProcess::getUserTime() const {
+  return seconds(usage.ru_utime);
+}
+
+double STSHProcess::getSystemTime() const {
+  return seconds(usage.ru_stime);
+}
+
+double STSHProcess::getEndTime() const {
+  return finished != 0 ? finished : now();
+}
+
 static ostream& operator<<(ostream& os, STSHProcessState state) {
   const char *str = "Unknown";
   switch (state) {
@@ -31,3 +61,17 @@ ostream& operator<<(ostream& os, const STSHProcess& process) {
   for (const string& token: process.tokens) os << " " << token;
   return os;
 }
+
+string formatUsage(double user, double system, long maxResidentSize, double wall) {
+  ostringstream oss;
+  oss << fixed << setprecision(3) << setw(8) << user << "u " << setw(8) << system << "s "
+      << setw(8) << maxResidentSize << "K " << setw(8) << wall << "r";
+  return oss.str();
+}
+
+ostream& STSHProcess::printUsage(ostream& os) const {
+  os << setw(5) << pid << " " << setw(12) << left << state << right << " "
+     << formatUsage(getUserTime(), getSystemTime(), getMaxResidentSize(), getWallTime());
+  for (const string& token: tokens) os << " " << token;
+  return os;
+}
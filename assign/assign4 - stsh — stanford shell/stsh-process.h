@@ -17,6 +17,7 @@
 #include <vector>   // for vector
 #include <string>   // for string
 #include <iostream> // for ostream
+#include <sys/resource.h> // for struct rusage
 
 /**
  * Enumerated Type: STSHProcessState
@@ -48,13 +49,13 @@ public:
  * ------------------------
  * Default constructor, where the process id is set to 0 as a placeholder.
  */
-  STSHProcess(): pid(0) {}
+  STSHProcess(): pid(0), started(0), finished(0), usage() {}
 
 /**
  * Constructor: STSHProcess
  * ------------------------
  * Constructs the object to package the provided pid, command line, and process state
- * together.
+ * together.  The process's wall-clock time is measured from the moment it's constructed.
  */
   STSHProcess(pid_t pid, const command& command, STSHProcessState state = kRunning);
 
@@ -78,10 +79,57 @@ public:
  * ----------------
  * Sets the state of the process to be that provided.
  */
-  void setState(STSHProcessState state) { this->state = state; }
+  void setState(STSHProcessState state);
+
+/**
+ * Method: setUsage
+ * ----------------
+ * Records the resources the process has used, as reported by wait4 the last
+ * time the process changed state.  Until it's called, all are taken to be 0.
+ */
+  void setUsage(const struct rusage& usage) { this->usage = usage; }
+
+/**
+ * Methods: getUserTime, getSystemTime, getMaxResidentSize
+ * -------------------------------------------------------
+ * Return the user and system CPU time the process had used (in seconds) when it
+ * last changed state, and the largest its resident set has been (in kilobytes).
+ */
+  double getUserTime() const;
+  double getSystemTime() const;
+  long getMaxResidentSize() const { return usage.ru_maxrss; }
+
+/**
+ * Methods: getStartTime, getEndTime, getWallTime
+ * ----------------------------------------------
+ * Return the CLOCK_MONOTONIC time (in seconds) the process started at, the time
+ * it terminated at (or the current time, if it hasn't), and the difference.
+ */
+  double getStartTime() const { return started; }
+  double getEndTime() const;
+  double getWallTime() const { return getEndTime() - started; }
+
+/**
+ * Method: printUsage
+ * ------------------
+ * Inserts the process into os as operator<< would, but with its resource
+ * usage listed between its state and its command line.
+ */
+  std::ostream& printUsage(std::ostream& os) const;
 
 private:
   pid_t pid;
   std::vector<std::string> tokens;
   STSHProcessState state;
+  double started;  // CLOCK_MONOTONIC seconds, as are...
+  double finished; // ...these, 0 until the process terminates
+  struct rusage usage;
 };
+
+/**
+ * Function: formatUsage
+ * ---------------------
+ * Returns the columns STSHProcess::printUsage (and STSHJob::printUsage,
+ * for a whole job) lists resource usage in.
+ */
+std::string formatUsage(double user, double system, long maxResidentSize, double wall);
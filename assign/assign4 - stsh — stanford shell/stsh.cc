@@ -11,52 +11,216 @@
 #include "stsh-job-list.h"
 #include "stsh-job.h"
 #include "stsh-process.h"
+#include "stsh-launch.h"
+#include "stsh-path-cache.h"
+#include "stsh-parse-utils.h"
 #include <cstring>
 #include <iostream>
 #include <string>
 #include <algorithm>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/signalfd.h>
 #include <unistd.h>  // for fork
 #include <signal.h>  // for kill
 #include <sys/wait.h>
+#include <sys/resource.h>  // for wait4
 #include <assert.h>
 #include <iomanip>
+#include <map>
+#include <time.h>
 using namespace std;
 
 static STSHJobList joblist; // the one piece of global data we need so signal handlers can access it
+static STSHPathCache paths; // where in $PATH each command we've run was found
+static size_t timedJobNum = 0; // the job a time builtin is waiting on, if any...
+static STSHJob timedJob;       // ...and the job as it was last seen, since it leaves the job list when it finishes
 
-static void handle_fg(const pipeline& pipeline) {
-	sigset_t additions, existingmask;
-	sigemptyset(&additions);
-	sigaddset(&additions, SIGCHLD);
-	sigaddset(&additions, SIGINT);
-	sigaddset(&additions, SIGTSTP);
-	sigaddset(&additions, SIGCONT);
-	sigprocmask(SIG_BLOCK, &additions, &existingmask);
+/**
+ * What batch mode reports on once the batch is done, for each job: the command
+ * line it came from, when it was queued (0 if it never was), and when its first
+ * process started and its last one finished.
+ */
+struct batchRecord {
+	string commandLine;
+	double queued = 0;
+	double started = 0;
+	double finished = 0;
+};
+static map<size_t, batchRecord> batchRecords; // job number -> record, kept in batch mode only
+static string currentLine; // the command line being executed, which is what a new job's record names
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Function: transferTerminalControl
+ * ---------------------------------
+ * Hands the terminal to the process group pgid.  It's fine for stdin not
+ * to be a terminal at all (when stsh is reading a script, say).
+ */
+static void transferTerminalControl(pid_t pgid) {
+	int err = tcsetpgrp(STDIN_FILENO, pgid);
+	if(err == -1 && errno != ENOTTY) {
+		throw STSHException("A more serious problem happens.");
+	}
+}
+
+/**
+ * The signals stsh handles, which are kept blocked and collected through
+ * signalfd rather than delivered to handlers, so that the job list is only
+ * ever changed synchronously, from handleSignals.  shellMask is the signal
+ * mask stsh started with, which every child is given back before it execs.
+ */
+static int signals = -1;
+static sigset_t shellMask;
+
+/**
+ * Function: reapChildren
+ * ----------------------
+ * Reaps every child with news to report, and updates the job list to match.
+ */
+static void reapChildren() {
+	while(true) {
+		int status;
+		struct rusage usage; // wait4 reports it however the child changed state, not just when it exits
+		pid_t pid = wait4(-1, &status, WNOHANG|WUNTRACED|WCONTINUED, &usage);
+
+		if(pid <= 0) break;
+
+		STSHJob& job = joblist.getJobWithProcess(pid); 
+		assert(job.containsProcess(pid));
+		STSHProcess& process = job.getProcess(pid);
+		process.setUsage(usage);
+		if(WIFEXITED(status) || WIFSIGNALED(status)) {
+			process.setState(kTerminated);
+		} else if(WIFSTOPPED(status)) {
+			process.setState(kStopped);
+		} else if(WIFCONTINUED(status)) {
+			process.setState(kRunning);
+		}
+		if(job.getNum() == timedJobNum) timedJob = job;
+		if(rlbatch() && process.getState() == kTerminated) {
+			batchRecord& record = batchRecords[job.getNum()];
+			record.started = job.getProcesses()[0].getStartTime(); // the stages are started in order
+			record.finished = process.getEndTime();
+		}
+		joblist.synchronize(job);
+	}
+}
+
+/**
+ * Function: addProcesses
+ * ----------------------
+ * Adds to job a process for every command launchPipeline managed to start.
+ */
+static void addProcesses(STSHJob& job, const vector<pid_t>& pids, const vector<command>& commands) {
+	for(unsigned int i = 0; i < pids.size(); i++) {
+		if(pids[i] != -1) job.addProcess(STSHProcess(pids[i], commands[i]));
+	}
+}
+
+/**
+ * Function: startQueuedJobs
+ * -------------------------
+ * Starts queued jobs, oldest first, for as long as there are job slots
+ * free for them.
+ */
+static void startQueuedJobs() {
+	while(joblist.hasQueuedJob() && joblist.hasFreeSlot()) {
+		string line;
+		STSHJob& job = joblist.dequeueJob(line);
+		job.getProcesses().clear(); // the waiting placeholders
+		try {
+			pipeline p(line);
+			addProcesses(job, launchPipeline(p.commands, p.input, p.output, shellMask, false, paths), p.commands);
+		} catch (const STSHException& e) {
+			cerr << e.what() << endl;
+		}
+		if(job.getProcesses().empty()) batchRecords.erase(job.getNum()); // it never ran, so there's nothing to report
+		joblist.synchronize(job); // drops it if nothing could be started
+	}
+}
+
+/**
+ * Function: forwardSignal
+ * -----------------------
+ * Passes a SIGINT or SIGTSTP stsh received on to the foreground job, if there is one.
+ */
+static void forwardSignal(int sig) {
+	if(joblist.hasForegroundJob()) {
+		STSHJob& job = joblist.getForegroundJob();
+		kill(-job.getGroupID(), sig);
+	}
+}
+
+/**
+ * Function: handleSignals
+ * -----------------------
+ * Acts on every signal that's arrived since the last call.  Any number of
+ * SIGCHLDs come down to one pass over the children.
+ */
+static void handleSignals() {
+	bool childrenChanged = false;
+	struct signalfd_siginfo info;
+	while(read(signals, &info, sizeof(info)) == sizeof(info)) {
+		if(info.ssi_signo == SIGCHLD) childrenChanged = true;
+		else forwardSignal(info.ssi_signo);
+	}
+	if(childrenChanged) {
+		reapChildren();
+		startQueuedJobs(); // into whatever slots just came free
+	}
+}
+
+/**
+ * Function: waitForForegroundJob
+ * ------------------------------
+ * Handles signals until there's no foreground job (because it's finished,
+ * or stopped).
+ */
+static void waitForForegroundJob() {
+	while(joblist.hasForegroundJob()) {
+		struct pollfd pfd = {signals, POLLIN, 0};
+		if(poll(&pfd, 1, -1) == -1 && errno != EINTR) throw STSHException("A more serious problem happens.");
+		handleSignals();
+	}
+}
 
+/**
+ * Function: waitForAllJobs
+ * ------------------------
+ * Handles signals until every job, queued ones included, has finished.
+ * (A stopped job has to be continued from elsewhere for that to happen.)
+ */
+static void waitForAllJobs() {
+	while(!joblist.isEmpty()) {
+		struct pollfd pfd = {signals, POLLIN, 0};
+		if(poll(&pfd, 1, -1) == -1 && errno != EINTR) throw STSHException("A more serious problem happens.");
+		handleSignals();
+	}
+}
+
+static void handle_fg(const pipeline& pipeline) {
 	char* token = pipeline.commands[0].tokens[0];
 	if(token == NULL) throw STSHException("Usage: fg <jobid>.");
 	if(strcmp(token, "0") == 0) throw STSHException("fg 0: No such job.");	
 	int jobId = atoi(token);
 	if(jobId == 0) throw STSHException("Usage: fg <jobid>.");
 	if(!joblist.containsJob(jobId)) throw STSHException("fg " + to_string(jobId) + ": No such job.");	
+	if(joblist.isQueued(jobId)) throw STSHException("fg " + to_string(jobId) + ": Job is still queued.");
 	STSHJob& job = joblist.getJob(jobId);
-	// job.setState(kForeground);
-	// pid_t pgid = job.getGroupID();
-	// kill(-pgid, SIGCONT);
-	vector<STSHProcess>& processes = job.getProcesses();
-	for(unsigned int i = 0; i < processes.size(); i++) {
-		STSHProcess &process = processes[i];
-		int err = kill(process.getID(), SIGCONT);
-		if(err == 0) {
-			job.setState(kForeground);
-		}
+	pid_t pgid = job.getGroupID();
+	transferTerminalControl(pgid);
+	if(kill(-pgid, SIGCONT) == 0) {
+		job.setState(kForeground);
 	}
 
-	while(joblist.hasForegroundJob()) {
-		sigsuspend(&existingmask);
-	}
-	sigprocmask(SIG_UNBLOCK, &additions, NULL);
+	waitForForegroundJob();
+	transferTerminalControl(getpgrp());
 }
 
 static void handle_bg(const pipeline& p) {
@@ -70,6 +234,7 @@ static void handle_bg(const pipeline& p) {
 	} else {				// two parameters: job id and pid
 		int iTwo = atoi(two);
 		if(!joblist.containsJob(iOne)) throw STSHException("No job with id of " + to_string(iOne));
+		if(joblist.isQueued(iOne)) throw STSHException("Job " + to_string(iOne) + " is still queued");
 		STSHJob& job = joblist.getJob(iOne);
 		vector<STSHProcess>& processes = job.getProcesses();
 		STSHProcess& process = processes[iTwo];
@@ -89,6 +254,7 @@ static void handle_slay(const pipeline& p) {
 	} else {				// two parameters: job id and pid
 		int iTwo = atoi(two);
 		if(!joblist.containsJob(iOne)) throw STSHException("No job with id of " + to_string(iOne));
+		if(joblist.isQueued(iOne)) throw STSHException("Job " + to_string(iOne) + " is still queued");
 		STSHJob& job = joblist.getJob(iOne);
 		vector<STSHProcess>& processes = job.getProcesses();
 		STSHProcess& process = processes[iTwo];
@@ -108,6 +274,7 @@ static void handle_halt(const pipeline& p) {
 	} else {				// two parameters: job id and pid
 		int iTwo = atoi(two);
 		if(!joblist.containsJob(iOne)) throw STSHException("No job with id of " + to_string(iOne));
+		if(joblist.isQueued(iOne)) throw STSHException("Job " + to_string(iOne) + " is still queued");
 		STSHJob& job = joblist.getJob(iOne);
 		vector<STSHProcess>& processes = job.getProcesses();
 		STSHProcess& process = processes[iTwo];
@@ -127,6 +294,7 @@ static void handle_cont(const pipeline& p) {
 	} else {				// two parameters: job id and pid
 		int iTwo = atoi(two);
 		if(!joblist.containsJob(iOne)) throw STSHException("No job with id of " + to_string(iOne));
+		if(joblist.isQueued(iOne)) throw STSHException("Job " + to_string(iOne) + " is still queued");
 		STSHJob& job = joblist.getJob(iOne);
 		vector<STSHProcess>& processes = job.getProcesses();
 		STSHProcess& process = processes[iTwo];
@@ -134,6 +302,75 @@ static void handle_cont(const pipeline& p) {
 		kill(process.getID(), SIGCONT);
 	}
 }
+
+static size_t createJob(const vector<command>& commands, const string& input, const string& output, bool background,
+                        bool timed = false);
+
+/**
+ * Function: handle_time
+ * ---------------------
+ * Runs the rest of the pipeline as a foreground job and, once it's finished
+ * (or stopped), reports every process's resource usage and the job's as a
+ * whole on stderr, much as bash's time does.
+ */
+static void handle_time(const pipeline& p) {
+	const command& first = p.commands[0];
+	if(first.tokens[0] == nullptr) throw STSHException("Usage: time <pipeline>.");
+	if(p.background) throw STSHException("time: Only foreground pipelines can be timed.");
+	if(strlen(first.tokens[0]) > kMaxCommandLength) throw STSHException(string(first.tokens[0]) + ": Command not found");
+
+	vector<command> commands(p.commands); // shares p's tokens, which p goes on owning
+	command& timed = commands[0];
+	strcpy(timed.command, first.tokens[0]);
+	for(unsigned int i = 0; i < kMaxArguments; i++) timed.tokens[i] = first.tokens[i + 1];
+	timed.tokens[kMaxArguments] = NULL;
+
+	timedJob = STSHJob();
+	if(createJob(commands, p.input, p.output, false, true) == 0) return;
+	const STSHJob& job = joblist.containsJob(timedJobNum) ? joblist.getJob(timedJobNum) : timedJob;
+	job.printUsage(cerr) << endl;
+	timedJobNum = 0;
+}
+
+static void handle_jobs(const pipeline& p) {
+	char* option = p.commands[0].tokens[0];
+	if(option == nullptr) cout << joblist;
+	else if(strcmp(option, "-l") == 0 && p.commands[0].tokens[1] == nullptr) joblist.printUsage(cout);
+	else throw STSHException("Usage: jobs [-l].");
+}
+
+static void handle_slots(const pipeline& p) {
+	char* limit = p.commands[0].tokens[0];
+	if(limit == nullptr) {
+		if(joblist.getSlotLimit() == 0) cout << "Job slots: unlimited" << endl;
+		else cout << "Job slots: " << joblist.getSlotLimit() << endl;
+		return;
+	}
+	if(p.commands[0].tokens[1] != nullptr) throw STSHException("Usage: slots [<limit>].");
+	joblist.setSlotLimit(parseNumber(limit, "Usage: slots [<limit>]."));
+	startQueuedJobs(); // should the limit have gone up
+}
+
+static void handle_hash(const pipeline& p) {
+	char* const* tokens = p.commands[0].tokens;
+	if(tokens[0] == nullptr) {
+		if(paths.empty()) cout << "hash: hash table empty" << endl;
+		else cout << paths;
+		return;
+	}
+	if(strcmp(tokens[0], "-r") == 0) {
+		if(tokens[1] != nullptr) throw STSHException("Usage: hash [-r] [command ...].");
+		paths.clear();
+		return;
+	}
+	string missing;
+	for(unsigned int i = 0; tokens[i] != nullptr; i++) {
+		paths.forget(tokens[i]); // so it's searched for afresh, as bash does
+		if(paths.lookup(tokens[i]).empty()) missing += string(missing.empty() ? "" : "\n") + "hash: " + tokens[i] + ": not found";
+	}
+	if(!missing.empty()) throw STSHException(missing);
+}
+
 /**
  * Function: handleBuiltin
  * -----------------------
@@ -141,7 +378,7 @@ static void handle_cont(const pipeline& p) {
  * it's a shell builtin, and if so, handles and executes it.  handleBuiltin
  * returns true if the command is a builtin, and false otherwise.
  */
-static const string kSupportedBuiltins[] = {"quit", "exit", "fg", "bg", "slay", "halt", "cont", "jobs"};
+static const string kSupportedBuiltins[] = {"quit", "exit", "fg", "bg", "slay", "halt", "cont", "jobs", "hash", "time", "slots"};
 static const size_t kNumSupportedBuiltins = sizeof(kSupportedBuiltins)/sizeof(kSupportedBuiltins[0]);
 static bool handleBuiltin(const pipeline& pipeline) {
 	const string& command = pipeline.commands[0].command;
@@ -163,7 +400,13 @@ static bool handleBuiltin(const pipeline& pipeline) {
 		case 6:
 				handle_cont(pipeline); break;
 		case 7: 
-				cout << joblist; break;
+				handle_jobs(pipeline); break;
+		case 8:
+				handle_hash(pipeline); break;
+		case 9:
+				handle_time(pipeline); break;
+		case 10:
+				handle_slots(pipeline); break;
 		default: throw STSHException("Internal Error: Builtin command not supported."); // or not implemented yet
 	}
 
@@ -171,86 +414,24 @@ static bool handleBuiltin(const pipeline& pipeline) {
 }
 
 
-static void sigchld_handler(int sig) {
-	while(true) {
-		int status;
-		// pid_t pid = waitpid(-1, &status, WNOHANG|WUNTRACED);
-		pid_t pid = waitpid(-1, &status, WNOHANG|WUNTRACED|WCONTINUED);
-
-		if(pid <= 0) break;
-
-		if(WIFEXITED(status)) {
-			STSHJob& job = joblist.getJobWithProcess(pid); 
-			assert(job.containsProcess(pid));
-			STSHProcess& process = job.getProcess(pid);
-			process.setState(kTerminated);
-			joblist.synchronize(job);
-		}
-		if(WIFSIGNALED(status)) {
-			STSHJob& job = joblist.getJobWithProcess(pid); 
-			assert(job.containsProcess(pid));
-			STSHProcess& process = job.getProcess(pid);
-			process.setState(kTerminated);
-			joblist.synchronize(job);
-		}	
-		if(WIFSTOPPED(status)) {
-			STSHJob& job = joblist.getJobWithProcess(pid); 
-			assert(job.containsProcess(pid));
-			STSHProcess& process = job.getProcess(pid);
-			process.setState(kStopped);
-			joblist.synchronize(job);
-		}	
-		if(WIFCONTINUED(status)) {
-			STSHJob& job = joblist.getJobWithProcess(pid); 
-			assert(job.containsProcess(pid));
-			STSHProcess& process = job.getProcess(pid);
-			// job.setState(kForeground);	// go crazy! go nuts! why doesn't sync() set this state?!
-			process.setState(kRunning);
-			joblist.synchronize(job);
-		}	
-	}
-}
-
-static void sigint_handler(int sig) {
-	if(joblist.hasForegroundJob()) {
-		STSHJob& job = joblist.getForegroundJob();
-		// pid_t pgid = job.getGroupID();
-		// kill(-pgid, SIGINT);
-		vector<STSHProcess>& processes = job.getProcesses();
-		for(unsigned int i = 0; i < processes.size(); i++) {
-			STSHProcess &process = processes[i];
-			kill(process.getID(), SIGINT);
-		}
-	}	
-}
-
-static void sigtstp_handler(int sig) {
-	if(joblist.hasForegroundJob()) {
-		STSHJob& job = joblist.getForegroundJob();
-		// pid_t pgid = job.getGroupID();
-		// kill(-pgid, SIGTSTP);
-		vector<STSHProcess>& processes = job.getProcesses();
-		for(unsigned int i = 0; i < processes.size(); i++) {
-			STSHProcess &process = processes[i];
-			kill(process.getID(), SIGTSTP);
-		}
-	}	
-}
 /**
  * Function: installSignalHandlers
  * -------------------------------
- * Installs user-defined signals handlers for four signals
- * (once you've implemented signal handlers for SIGCHLD, 
- * SIGINT, and SIGTSTP, you'll add more installSignalHandler calls) and 
- * ignores two others.
+ * Installs a handler for SIGQUIT and ignores two others.  SIGCHLD, SIGINT
+ * and SIGTSTP are blocked instead, and read from the signalfd this creates.
  */
 static void installSignalHandlers() {
 	installSignalHandler(SIGQUIT, [](int sig) { exit(0); });
 	installSignalHandler(SIGTTIN, SIG_IGN);
 	installSignalHandler(SIGTTOU, SIG_IGN);
-	installSignalHandler(SIGCHLD, sigchld_handler);
-	installSignalHandler(SIGINT, sigint_handler);
-	installSignalHandler(SIGTSTP, sigtstp_handler);
+	sigset_t handled;
+	sigemptyset(&handled);
+	sigaddset(&handled, SIGCHLD);
+	sigaddset(&handled, SIGINT);
+	sigaddset(&handled, SIGTSTP);
+	sigprocmask(SIG_BLOCK, &handled, &shellMask);
+	signals = signalfd(-1, &handled, SFD_NONBLOCK | SFD_CLOEXEC);
+	if(signals == -1) throw STSHException("Failed to create a signalfd.");
 }
 
 static void showPipeline(const pipeline& p) {
@@ -263,124 +444,29 @@ static void showPipeline(const pipeline& p) {
 /**
  * Function: createJob
  * -------------------
- * Creates a new job on behalf of the provided pipeline.
+ * Creates a new job on behalf of the provided pipeline (or of the given
+ * commands, redirected and backgrounded as a pipeline would be), and returns
+ * its job number, or 0 if none of its processes could be launched.  A timed
+ * job is the one a time builtin reports on, and is tracked as such before
+ * it's waited on.
  */
-static void createJob(const pipeline& p) {
-	// showPipeline(p);
-	STSHJob& job = joblist.addJob(kForeground);
+static size_t createJob(const vector<command>& commands, const string& input, const string& output, bool background,
+                        bool timed) {
+	// SIGCHLD is only ever read off the signalfd, so nothing can be reaped before
+	// it's been added to the job below
+	vector<pid_t> pids = launchPipeline(commands, input, output, shellMask, !background, paths);
 	pid_t pgid = 0;
-	if(p.background) {
-		job.setState(kBackground);
-	}
-
-	int fds[p.commands.size() - 1][2];
-	for(unsigned int i = 0; i < p.commands.size() - 1; i++) {
-		pipe(fds[i]);
-	}
-	
-	int infd = 0;
-	if(!p.input.empty()) {
-		infd = open(p.input.c_str(), O_RDONLY);
-	}
-
-	int outfd = 0;
-	if(!p.output.empty()) {
-		outfd = open(p.output.c_str(), O_WRONLY|O_TRUNC);
-		if(outfd == -1 && errno == ENOENT) {
-			outfd = open(p.output.c_str(), O_WRONLY|O_CREAT, 0644);
-		}
-	}
-
-	for(unsigned int i = 0; i < p.commands.size(); i++) {
-		pid_t pid = fork();
-		if(pid == 0) {
-			// for fds
-			if(i == 0) {
-				if(!p.input.empty()) {
-					dup2(infd, STDIN_FILENO);
-					close(infd);
-				}
-				close(fds[i][0]);
-				dup2(fds[i][1], STDOUT_FILENO);
-				close(fds[i][1]);
-				for(unsigned int j = 1; j < p.commands.size() - 1; j++) {
-					close(fds[j][0]);
-					close(fds[j][1]);
-				}
-			} else if(i == p.commands.size() - 1) {
-				if(!p.output.empty()) {
-					dup2(outfd, STDOUT_FILENO);
-					close(outfd);
-				}
-				close(fds[i - 1][1]);
-				dup2(fds[i - 1][0], STDIN_FILENO);
-				close(fds[i - 1][0]);
-				for(unsigned int j = 0; j < p.commands.size() - 2; j++) {
-					close(fds[j][0]);
-					close(fds[j][1]);
-				}
-			} else  {
-				close(fds[i - 1][1]);
-				dup2(fds[i - 1][0], STDIN_FILENO);
-				close(fds[i - 1][0]);
-				close(fds[i][0]);
-				dup2(fds[i][1], STDOUT_FILENO);
-				close(fds[i][1]);
-				for(unsigned int j = 0; j < p.commands.size() - 1; j++) {
-					if(j != i - 1 && j != i) {
-						close(fds[j][0]);
-						close(fds[j][1]);
-					}
-				}
-			}
-
-
-
-			char* argv[kMaxArguments + 2] = {NULL};
-			argv[0] = const_cast<char*>(p.commands[i].command);
-			for(unsigned int j = 0; j <= kMaxArguments && p.commands[i].tokens[j] != NULL; j++) {
-				argv[j + 1] = p.commands[i].tokens[j];
-			}
-			if(i == 0) {
-				pgid = getpid();
-				setpgid(getpid(), pid);
-			} else {
-				if(pgid != 0) {
-					setpgid(pid, pgid);
-				}
-			}
-			int err = execvp(argv[0], argv);
-			if(err < 0) throw STSHException("Command not found");
-		} else {
-
-			job.addProcess(STSHProcess(pid, p.commands[i]));
-			if(i == 0) {
-				pgid = pid;
-				setpgid(pid, pgid);
-
-			} else {
-				if(pgid != 0) {
-					setpgid(pid, pgid);
-				}
-			}
-		}
-	}
-
-	// close fds
-	for(unsigned int i = 0; i < p.commands.size() - 1; i++) {
-		close(fds[i][0]);
-		close(fds[i][1]);
+	for(unsigned int i = 0; i < pids.size() && pgid == 0; i++) {
+		if(pids[i] != -1) pgid = pids[i]; // the first spawned leads the group
 	}
+	if(pgid == 0) return 0; // not one of them could be spawned
 
-	sigset_t additions, existingmask;
-	sigemptyset(&additions);
-	sigaddset(&additions, SIGCHLD);
-	sigaddset(&additions, SIGINT);
-	sigaddset(&additions, SIGTSTP);
-	sigaddset(&additions, SIGCONT);
-	sigprocmask(SIG_BLOCK, &additions, &existingmask);
+	STSHJob& job = joblist.addJob(background ? kBackground : kForeground);
+	addProcesses(job, pids, commands);
+	if(timed) timedJobNum = job.getNum();
+	if(rlbatch()) batchRecords[job.getNum()].commandLine = currentLine;
 
-	if(p.background) {
+	if(background) {
 		string str = "";
 		str += "[" + to_string(job.getNum()) + "]";
 		cout << setw(str.size()) << str << " ";
@@ -391,27 +477,60 @@ static void createJob(const pipeline& p) {
 		cout << endl;
 	}
 
-	if(joblist.hasForegroundJob()) {
-		int err = tcsetpgrp(STDIN_FILENO, pgid);
-		if(err == -1) {
-			if(errno != ENOTTY) {
-				throw STSHException("A more serious problem happens.");
-			}
-		}
-	}
+	if(!background) transferTerminalControl(pgid); // a no-op if the spawn already handed it over
 
-	while(joblist.hasForegroundJob()) {
-		sigsuspend(&existingmask);
+	size_t num = job.getNum();
+	waitForForegroundJob();
+	transferTerminalControl(getpgrp());
+	return num;
+}
+
+/**
+ * Function: queueJob
+ * ------------------
+ * Queues a background job for the provided pipeline, to be started (from line,
+ * the command line it was parsed from) once there's a job slot free for it.
+ */
+static void queueJob(const pipeline& p, const string& line) {
+	STSHJob& job = joblist.queueJob(line);
+	for(unsigned int i = 0; i < p.commands.size(); i++) {
+		job.addProcess(STSHProcess(0, p.commands[i], kWaiting));
+	}
+	if(rlbatch()) {
+		batchRecords[job.getNum()].commandLine = line;
+		batchRecords[job.getNum()].queued = now();
 	}
-	sigprocmask(SIG_UNBLOCK, &additions, NULL);
+	cout << "[" << job.getNum() << "] Queued" << endl;
+}
 
-	pid_t parent = getpgid(getpid());
-	int err = tcsetpgrp(STDIN_FILENO, parent);
-	if(err == -1) {
-		if(errno != ENOTTY) {
-			throw STSHException("A more serious problem happens.");
-		}
+/**
+ * Function: printBatchSummary
+ * ---------------------------
+ * Reports how long each job of a batch spent queued and how long it ran,
+ * along with the averages and maximums of both.
+ */
+static void printBatchSummary(double elapsed) {
+	cout << fixed << setprecision(3);
+	cout << "Ran " << batchRecords.size() << " jobs in " << elapsed << " seconds";
+	if(joblist.getSlotLimit() != 0) cout << ", " << joblist.getSlotLimit() << " at a time";
+	cout << "." << endl;
+	if(batchRecords.empty()) return;
+
+	cout << setw(6) << "job" << setw(10) << "waited" << setw(10) << "ran" << "  command" << endl;
+	double totalWait = 0, maxWait = 0, totalRun = 0, maxRun = 0;
+	for(const pair<const size_t, batchRecord>& p: batchRecords) {
+		const batchRecord& record = p.second;
+		double wait = record.queued == 0 ? 0 : record.started - record.queued;
+		double run = record.finished - record.started;
+		totalWait += wait;
+		maxWait = max(maxWait, wait);
+		totalRun += run;
+		maxRun = max(maxRun, run);
+		cout << setw(6) << "[" + to_string(p.first) + "]" << setw(10) << wait << setw(10) << run
+		     << "  " << record.commandLine << endl;
 	}
+	cout << "Waited " << totalWait / batchRecords.size() << " seconds on average, " << maxWait << " at most." << endl;
+	cout << "Ran " << totalRun / batchRecords.size() << " seconds on average, " << maxRun << " at most." << endl;
 }
 
 /**
@@ -423,21 +542,43 @@ static void createJob(const pipeline& p) {
  */
 int main(int argc, char *argv[]) {
 	pid_t stshpid = getpid();
+	double start = now();
 	installSignalHandlers();
 	rlinit(argc, argv);
+	rlprompt();
 	while (true) {
+		// wait for a line of input, dealing with whatever signals arrive in the meantime
+		if (!rlready()) {
+			struct pollfd fds[] = {{rlinput(), POLLIN, 0}, {signals, POLLIN, 0}};
+			if (poll(fds, 2, -1) == -1 && errno != EINTR) break;
+			if (fds[1].revents != 0) handleSignals();
+			if (fds[0].revents == 0) continue;
+		}
 		string line;
-		if (!readline(line)) break;
-		if (line.empty()) continue;
+		bool eof;
+		if (!rlread(line, eof)) continue;
+		if (eof) break;
+		if (line.empty()) {
+			rlprompt();
+			continue;
+		}
+		handleSignals(); // so the command sees an up-to-date job list
+		currentLine = line;
 		try {
 			pipeline p(line);
 			bool builtin = handleBuiltin(p);
-			if (!builtin) createJob(p);
+			if (!builtin && p.background && !joblist.hasFreeSlot()) queueJob(p, line);
+			else if (!builtin) createJob(p.commands, p.input, p.output, p.background);
 		} catch (const STSHException& e) {
 			cerr << e.what() << endl;
 			if (getpid() != stshpid) exit(0); // if exception is thrown from child process, kill it
 		}
+		rlprompt();
 	}
 
+	if (rlbatch()) {
+		waitForAllJobs();
+		printBatchSummary(now() - start);
+	}
 	return 0;
 }